@@ -0,0 +1,72 @@
+#include "allocationcheck.h"
+#include "allocationcounter.h"
+#include "simulation.h"
+#include "arena.h"
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+    const int WarmUp = 100;
+    const int Checked = 100;
+
+    template<typename Function>
+    AllocationCheck::Result count(const QString& name, Function function)
+    {
+        for(int i = 0; i < WarmUp; i++)
+            function(i);
+        quint64 before = AllocationCounter::count();
+        for(int i = 0; i < Checked; i++)
+            function(WarmUp + i);
+        quint64 allocations = AllocationCounter::count() - before;
+        return { name, allocations, Checked };
+    }
+}
+
+std::vector<AllocationCheck::Result> AllocationCheck::measure()
+{
+    std::vector<Result> results;
+
+    for(bool lod : { false, true })
+    {
+        Simulation simulation;
+        simulation.populateGrid(1000);
+        simulation.m_gameObjects[0]->energy = QVector3D(0.3f, 0.0f, 0.1f);
+        if(lod)
+            simulation.addLodView(QVector3D(0.0f, 0.0f, 0.0f));
+        results.push_back(count(lod ? "simulation/stepLod" : "simulation/step", [&simulation](int)
+        {
+            simulation.step();
+        }));
+        simulation.clear();
+    }
+
+    // a frame that needs more than the arena holds, and a bit more every frame for a while
+    {
+        Arena arena(1024);
+        results.push_back(count("arena/frame", [&arena](int frame)
+        {
+            int blocks = 16 + qMin(frame, WarmUp / 2);
+            for(int i = 0; i < blocks; i++)
+                arena.allocate<float>(64 + i);
+            arena.reset();
+        }));
+    }
+
+    return results;
+}
+
+int AllocationCheck::run()
+{
+    int failures = 0;
+    cout << "heap check: " << WarmUp << " warm up iterations" << endl;
+    for(const Result& result : measure())
+    {
+        cout << "  " << result.name.toStdString() << ": " << result.allocations << " allocations in "
+             << result.iterations << " iterations" << (result.allocations > 0 ? " FAILED" : "") << endl;
+        if(result.allocations > 0)
+            failures++;
+    }
+    return failures > 0 ? 1 : 0;
+}
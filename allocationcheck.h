@@ -0,0 +1,25 @@
+#ifndef ALLOCATIONCHECK_H
+#define ALLOCATIONCHECK_H
+
+#include <QString>
+#include <vector>
+
+// runs the steady state paths that are meant to stay off the heap, ticks of a colliding
+// world with and without the simulation LOD and frames through an arena, and counts the
+// allocations after a warm up; headless, so it can gate a build
+namespace AllocationCheck
+{
+    struct Result
+    {
+        QString name;
+        quint64 allocations;
+        int iterations;
+    };
+
+    std::vector<Result> measure();
+
+    // prints every result, returns nonzero when any of them allocated
+    int run();
+}
+
+#endif // ALLOCATIONCHECK_H
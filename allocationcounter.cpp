@@ -0,0 +1,141 @@
+#include "allocationcounter.h"
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+// per thread, so worker threads do not show up in the frame of the gui thread
+static thread_local quint64 t_allocations = 0;
+
+quint64 AllocationCounter::count()
+{
+    return t_allocations;
+}
+
+#if defined(__GLIBC__)
+// glibc lets the executable replace the malloc family and still reach its own through
+// the __libc_ entry points; counting there also catches Qt containers, qMallocAligned
+// and whatever else skips operator new, which then only forwards
+#define ALLOCATIONS_FROM_MALLOC
+
+extern "C"
+{
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* p, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+    void __libc_free(void* p);
+
+    void* malloc(std::size_t size) noexcept
+    {
+        t_allocations++;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) noexcept
+    {
+        t_allocations++;
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* p, std::size_t size) noexcept
+    {
+        // realloc(p, 0) frees
+        if(size != 0)
+            t_allocations++;
+        return __libc_realloc(p, size);
+    }
+
+    void* memalign(std::size_t alignment, std::size_t size) noexcept
+    {
+        t_allocations++;
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+    {
+        t_allocations++;
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** p, std::size_t alignment, std::size_t size) noexcept
+    {
+        if(alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+        t_allocations++;
+        *p = __libc_memalign(alignment, size);
+        return *p != nullptr ? 0 : ENOMEM;
+    }
+
+    void free(void* p) noexcept
+    {
+        __libc_free(p);
+    }
+}
+#endif
+
+static void* countedAllocate(std::size_t size)
+{
+#ifndef ALLOCATIONS_FROM_MALLOC
+    t_allocations++;
+#endif
+    void* p = std::malloc(size ? size : 1);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+#ifndef ALLOCATIONS_FROM_MALLOC
+    t_allocations++;
+#endif
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+#ifndef ALLOCATIONS_FROM_MALLOC
+    t_allocations++;
+#endif
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
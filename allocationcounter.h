@@ -0,0 +1,15 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+// the malloc family, where glibc allows replacing it, or else global operator new is
+// replaced by a counting one; the difference of two counts tells how often a frame or
+// tick went to the heap
+namespace AllocationCounter
+{
+    // allocations made by the calling thread so far
+    quint64 count();
+}
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,53 @@
+#include "arena.h"
+#include <cstdint>
+
+using namespace std;
+
+Arena::Arena(size_t capacity)
+    : m_block(new char[capacity]), m_capacity(capacity), m_offset(0), m_overflowSize(0)
+{
+}
+
+Arena::~Arena()
+{
+    reset();
+    delete[] m_block;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    uintptr_t base = reinterpret_cast<uintptr_t>(m_block);
+    uintptr_t p = (base + m_offset + alignment - 1) & ~uintptr_t(alignment - 1);
+    if(p + size <= base + m_capacity)
+    {
+        m_offset = p + size - base;
+        return reinterpret_cast<void*>(p);
+    }
+
+    // full, the overflow only lives until the next reset
+    char* block = new char[size + alignment];
+    m_overflow.push_back(block);
+    m_overflowSize += size + alignment;
+    p = (reinterpret_cast<uintptr_t>(block) + alignment - 1) & ~uintptr_t(alignment - 1);
+    return reinterpret_cast<void*>(p);
+}
+
+void Arena::reset()
+{
+    if(!m_overflow.empty())
+    {
+        // grow so that everything this frame needed fits next time
+        size_t needed = m_offset + m_overflowSize;
+        for(char* block : m_overflow)
+            delete[] block;
+        // the list keeps its capacity, the next overflow appends without allocating it again
+        m_overflow.clear();
+
+        while(m_capacity < needed)
+            m_capacity *= 2;
+        delete[] m_block;
+        m_block = new char[m_capacity];
+    }
+    m_offset = 0;
+    m_overflowSize = 0;
+}
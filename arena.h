@@ -0,0 +1,44 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+// linear allocator for data that lives for one frame or one tick: allocations only bump
+// an offset and reset() releases all of them at once; what does not fit goes into
+// overflow blocks and the next reset grows the main block, so after a few frames
+// the steady state never reaches the heap
+class Arena
+{
+public:
+    explicit Arena(size_t capacity = 64 * 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+
+    // uninitialized storage for count objects, nothing is destroyed on reset
+    template<typename T>
+    T* allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void reset();
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_offset + m_overflowSize; }
+
+private:
+    char* m_block;
+    size_t m_capacity;
+    size_t m_offset;
+    std::vector<char*> m_overflow;
+    size_t m_overflowSize;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,39 @@
+#include "assetregistry.h"
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+    // the interned names live for the whole run, like the string literals they come from
+    unordered_map<string, quint32>& nameIds()
+    {
+        static unordered_map<string, quint32> ids;
+        return ids;
+    }
+
+    vector<string>& names()
+    {
+        static vector<string> strings;
+        return strings;
+    }
+}
+
+AssetName::AssetName(const string &name)
+{
+    auto it = nameIds().find(name);
+    if(it != nameIds().end())
+    {
+        m_id = it->second;
+        return;
+    }
+    m_id = quint32(names().size());
+    names().push_back(name);
+    nameIds().emplace(name, m_id);
+}
+
+const string& AssetName::str() const
+{
+    static const string none;
+    return m_id < names().size() ? names()[m_id] : none;
+}
@@ -0,0 +1,200 @@
+#ifndef ASSETREGISTRY_H
+#define ASSETREGISTRY_H
+
+#include <QtGlobal>
+#include <string>
+#include <vector>
+
+// asset names are interned once into dense ids, finding an asset by an interned
+// name is an array index instead of a string compare
+class AssetName
+{
+public:
+    static const quint32 Invalid = 0xFFFFFFFF;
+
+    AssetName() : m_id(Invalid) {}
+    explicit AssetName(const std::string& name);
+
+    quint32 id() const { return m_id; }
+    const std::string& str() const;
+
+private:
+    quint32 m_id;
+};
+
+// 32 bit handle: slot index in the low bits, the slot's generation in the high bits;
+// a handle to a released asset stops resolving once its slot is reused
+template<typename T>
+struct AssetHandle
+{
+    static const int IndexBits = 20;
+    static const quint32 IndexMask = (1u << IndexBits) - 1;
+
+    quint32 value = 0;
+
+    quint32 index() const { return value & IndexMask; }
+    quint32 generation() const { return value >> IndexBits; }
+    bool isValid() const { return value != 0; }
+    bool operator==(AssetHandle other) const { return value == other.value; }
+    bool operator!=(AssetHandle other) const { return value != other.value; }
+};
+
+// owns the assets of one type; whoever keeps an asset holds a reference, when the last
+// one is released the name is dropped at once but the asset itself is only deleted by
+// collect(), called where its GPU resources may be freed
+template<typename T>
+class AssetRegistry
+{
+public:
+    typedef AssetHandle<T> Handle;
+
+    static AssetRegistry& instance()
+    {
+        static AssetRegistry registry;
+        return registry;
+    }
+
+    // takes ownership, the caller holds the first reference
+    Handle add(const AssetName& name, T* asset)
+    {
+        quint32 index;
+        if(!m_free.empty())
+        {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            index = quint32(m_slots.size());
+            m_slots.push_back(Slot());
+        }
+
+        Slot& slot = m_slots[index];
+        slot.asset = asset;
+        slot.refs = 1;
+        slot.name = name.id();
+
+        Handle handle;
+        handle.value = slot.generation << Handle::IndexBits | index;
+        if(m_byName.size() <= name.id())
+            m_byName.resize(name.id() + 1);
+        m_byName[name.id()] = handle;
+        return handle;
+    }
+
+    // invalid handle when nothing of that name is loaded
+    Handle find(const AssetName& name) const
+    {
+        return name.id() < m_byName.size() ? m_byName[name.id()] : Handle();
+    }
+
+    T* get(Handle handle) const
+    {
+        const Slot* slot = resolve(handle);
+        return slot != nullptr ? slot->asset : nullptr;
+    }
+
+    int refCount(Handle handle) const
+    {
+        const Slot* slot = resolve(handle);
+        return slot != nullptr ? slot->refs : 0;
+    }
+
+    void acquire(Handle handle)
+    {
+        Slot* slot = const_cast<Slot*>(resolve(handle));
+        if(slot != nullptr)
+            slot->refs++;
+    }
+
+    void release(Handle handle)
+    {
+        Slot* slot = const_cast<Slot*>(resolve(handle));
+        if(slot == nullptr || --slot->refs > 0)
+            return;
+
+        m_released.push_back(slot->asset);
+        m_byName[slot->name] = Handle();
+        slot->asset = nullptr;
+        slot->generation = (slot->generation + 1) & (0xFFFFFFFFu >> Handle::IndexBits);
+        if(slot->generation == 0)
+            slot->generation = 1;
+        m_free.push_back(handle.index());
+    }
+
+    // deletes the assets whose last reference is gone
+    void collect()
+    {
+        for(T* asset : m_released)
+            delete asset;
+        m_released.clear();
+    }
+
+    // calls function(handle, asset) for every live asset
+    template<typename Function>
+    void forEach(Function function) const
+    {
+        for(quint32 i = 0; i < m_slots.size(); i++)
+        {
+            const Slot& slot = m_slots[i];
+            if(slot.asset == nullptr)
+                continue;
+            Handle handle;
+            handle.value = slot.generation << Handle::IndexBits | i;
+            function(handle, slot.asset);
+        }
+    }
+
+    int pendingReleases() const { return int(m_released.size()); }
+
+private:
+    struct Slot
+    {
+        T* asset = nullptr;
+        quint32 generation = 1;
+        int refs = 0;
+        quint32 name = AssetName::Invalid;
+    };
+
+    const Slot* resolve(Handle handle) const
+    {
+        if(!handle.isValid() || handle.index() >= m_slots.size())
+            return nullptr;
+        const Slot& slot = m_slots[handle.index()];
+        return slot.generation == handle.generation() && slot.asset != nullptr ? &slot : nullptr;
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<quint32> m_free;
+    std::vector<Handle> m_byName;   // indexed by interned name id
+    std::vector<T*> m_released;
+};
+
+// a counted reference, copying it acquires and destroying it releases
+template<typename T>
+class AssetRef
+{
+public:
+    AssetRef() {}
+    AssetRef(AssetHandle<T> handle) : m_handle(handle) { AssetRegistry<T>::instance().acquire(m_handle); }
+    AssetRef(const AssetRef& other) : m_handle(other.m_handle) { AssetRegistry<T>::instance().acquire(m_handle); }
+    ~AssetRef() { AssetRegistry<T>::instance().release(m_handle); }
+
+    AssetRef& operator=(const AssetRef& other)
+    {
+        AssetRegistry<T>::instance().acquire(other.m_handle);
+        AssetRegistry<T>::instance().release(m_handle);
+        m_handle = other.m_handle;
+        return *this;
+    }
+
+    AssetHandle<T> handle() const { return m_handle; }
+    T* get() const { return AssetRegistry<T>::instance().get(m_handle); }
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return get() != nullptr; }
+
+private:
+    AssetHandle<T> m_handle;
+};
+
+#endif // ASSETREGISTRY_H
@@ -0,0 +1,406 @@
+#include "benchmark.h"
+#include "particlesystem.h"
+#include "gameserver.h"
+#include "netclient.h"
+#include "player.h"
+#include "cube.h"
+#include "simulation.h"
+#include "savegame.h"
+#include "cmesh.h"
+#include "procedural.h"
+#include "bullet.h"
+#include "allocationcheck.h"
+#include <QBuffer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QThread>
+#include <QFile>
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+
+using namespace std;
+
+int Benchmark::particles()
+{
+    const int counts[] = { 10000, 100000, 250000, 1000000 };
+    const int iterations = 200;
+
+    for(int count : counts)
+    {
+        ParticleSystem particles;
+        while(particles.liveCount(ParticleSystem::Impact) < count)
+            particles.emit(ParticleSystem::Impact, QVector3D(0,0,0), QVector3D(0,0,0), qMin(4096, count - particles.liveCount()));
+
+        // tiny steps keep every particle alive for the whole run
+        QElapsedTimer timer;
+        timer.start();
+        for(int i = 0; i < iterations; i++)
+            particles.update(0.0001f);
+        qint64 ns = timer.nsecsElapsed();
+
+        double perMs = double(count) * iterations / (ns * 1e-6);
+        cout << "particles: " << count << " live, " << perMs << " particles updated per ms" << endl;
+    }
+
+    return 0;
+}
+
+int Benchmark::network(int clients, int seconds)
+{
+    GameServer server;
+    if(!server.listen(0))
+        return 1;
+
+    std::vector<NetClient*> bots;
+    for(int i = 0; i < clients; i++)
+    {
+        NetClient* bot = new NetClient();
+        bot->connectToServer(QHostAddress::LocalHost, server.port());
+        bots.push_back(bot);
+    }
+
+    // every simulated client walks around and fires now and then
+    int tick = 0;
+    QTimer input;
+    input.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&input, &QTimer::timeout, [&]()
+    {
+        tick++;
+        for(int i = 0; i < clients; i++)
+        {
+            quint8 buttons = ((tick / 30 + i) % 2) ? Player::Forward : Player::Left;
+            bots[i]->sendInput(buttons, (tick + i) % 90 == 0, tick * 0.01f + i, 1.57f);
+        }
+    });
+    input.start(1000 / Net::TickRate);
+
+    QEventLoop loop;
+    QTimer::singleShot(seconds * 1000, &loop, &QEventLoop::quit);
+    loop.exec();
+    input.stop();
+
+    quint64 received = 0;
+    quint64 snapshots = 0;
+    std::vector<qint64> roundTrips;
+    for(NetClient* bot : bots)
+    {
+        received += bot->bytesReceived();
+        snapshots += bot->snapshotsReceived();
+        roundTrips.insert(roundTrips.end(), bot->roundTrips().begin(), bot->roundTrips().end());
+        delete bot;
+    }
+    std::sort(roundTrips.begin(), roundTrips.end());
+
+    cout << "network: " << clients << " clients, " << seconds << " s" << endl;
+    cout << "  server upstream " << server.bytesSent() / 1024.0 / seconds << " KiB/s" << endl;
+    cout << "  per client " << received / 1024.0 / seconds / clients << " KiB/s, "
+         << snapshots / double(seconds) / clients << " snapshots/s" << endl;
+    if(!roundTrips.empty())
+    {
+        size_t n = roundTrips.size();
+        cout << "  input round trip [ms] avg " << std::accumulate(roundTrips.begin(), roundTrips.end(), qint64(0)) * 1e-6 / n
+             << " p95 " << roundTrips[n * 95 / 100] * 1e-6
+             << " max " << roundTrips.back() * 1e-6 << endl;
+    }
+
+    return 0;
+}
+
+int Benchmark::saveLoad(int objects)
+{
+    Simulation simulation;
+    Player player;
+    simulation.addObject(&player);
+
+    Cube prototype;
+    prototype.init();
+    for(int i = 1; i < objects; i++)
+    {
+        GameObject* cube = simulation.cloneObject(&prototype);
+        cube->position = QVector3D(i % 1000, 0, i / 1000);
+        simulation.m_gameObjects.push_back(cube);
+    }
+
+    const QString path = "benchmark.sav";
+    SaveGame save;
+    QElapsedTimer timer;
+    timer.start();
+    save.begin(path, &simulation, player, 'f');
+    qint64 longestStep = timer.nsecsElapsed();
+    int ticks = 0;
+    while(save.isBusy())
+    {
+        QElapsedTimer step;
+        step.start();
+        save.step();
+        longestStep = qMax(longestStep, step.nsecsElapsed());
+        ticks++;
+        QThread::msleep(1);
+    }
+    qint64 saveNs = timer.nsecsElapsed();
+
+    char cameraType;
+    timer.restart();
+    bool loaded = SaveGame::load(path, simulation, player, cameraType);
+    qint64 loadNs = timer.nsecsElapsed();
+
+    cout << "save/load: " << objects << " objects" << endl;
+    cout << "  save " << saveNs * 1e-6 << " ms over " << ticks << " ticks, longest tick " << longestStep * 1e-6 << " ms" << endl;
+    cout << "  load " << loadNs * 1e-6 << " ms" << endl;
+
+    simulation.clear(&player);
+    QFile::remove(path);
+    return loaded ? 0 : 1;
+}
+
+namespace
+{
+    struct Result
+    {
+        QString name;
+        double nsPerOp;
+        qint64 operations;
+    };
+
+    volatile float sink;
+
+    // runs function in batches long enough to time reliably and keeps the median batch,
+    // operations is how many units one call processes
+    template<typename Function>
+    Result measure(const QString& name, qint64 operations, Function function)
+    {
+        const qint64 minBatchNs = 20000000;
+        const int samples = 9;
+
+        QElapsedTimer timer;
+        qint64 batch = 1;
+        for(;;)
+        {
+            timer.start();
+            for(qint64 i = 0; i < batch; i++)
+                function();
+            if(timer.nsecsElapsed() >= minBatchNs || batch >= (1 << 24))
+                break;
+            batch *= 2;
+        }
+
+        std::vector<double> times;
+        for(int s = 0; s < samples; s++)
+        {
+            timer.start();
+            for(qint64 i = 0; i < batch; i++)
+                function();
+            times.push_back(double(timer.nsecsElapsed()) / (batch * operations));
+        }
+        std::sort(times.begin(), times.end());
+
+        Result result = { name, times[samples / 2], batch * samples * operations };
+        cout << "  " << name.toStdString() << ": " << result.nsPerOp << " ns/op" << endl;
+        return result;
+    }
+}
+
+int Benchmark::suite(const QString &output, const QString &baseline, double tolerance)
+{
+    std::vector<Result> results;
+    cout << "benchmark suite" << endl;
+
+    for(int n : { 12, 24, 48, 96 })
+    {
+        results.push_back(measure(QString("mesh/generateSphere/%1").arg(n), 1, [n]()
+        {
+            CMesh mesh;
+            mesh.generateSphere(0.5f, n);
+            sink = float(mesh.vertexCount());
+        }));
+    }
+
+    results.push_back(measure("procedural/sphere/512", 1, []()
+    {
+        CMesh mesh;
+        Procedural::sphere(mesh, 1.0f, 512, 256);
+        sink = float(mesh.vertexCount());
+    }));
+
+    const int terrainSize = 512;
+    results.push_back(measure("procedural/noiseHeights/512", 1, []()
+    {
+        std::vector<float> heights = Procedural::noiseHeights(terrainSize, terrainSize, 6, 1);
+        sink = heights[0];
+    }));
+    std::vector<float> heights = Procedural::noiseHeights(terrainSize, terrainSize, 6, 1);
+    results.push_back(measure("procedural/terrain/512", 1, [&heights]()
+    {
+        CMesh mesh;
+        Procedural::terrain(mesh, 100.0f, 100.0f, terrainSize, terrainSize, heights.data());
+        sink = float(mesh.vertexCount());
+    }));
+
+    // parsed from memory so the numbers do not depend on the disk
+    QFile objFile("resources/bunny.obj");
+    if(objFile.open(QFile::ReadOnly))
+    {
+        QByteArray obj = objFile.readAll();
+        results.push_back(measure("mesh/parseObj/bunny", 1, [&obj]()
+        {
+            QBuffer buffer(&obj);
+            buffer.open(QBuffer::ReadOnly);
+            CMesh mesh;
+            mesh.generateMeshFromObj(buffer);
+            sink = float(mesh.vertexCount());
+        }));
+    }
+    else
+    {
+        cout << "Loading resources/bunny.obj - Not Found!" << endl;
+    }
+
+    const int vertices = 10000;
+    results.push_back(measure("mesh/add", vertices, []()
+    {
+        CMesh mesh;
+        for(int i = 0; i < vertices; i++)
+            mesh.add(QVector3D(i, 0, 0), QVector3D(0, 1, 0), QVector2D(0, 0));
+        sink = float(mesh.vertexCount());
+    }));
+
+    {
+        Simulation simulation;
+        simulation.populateGrid(1000);
+        for(GameObject* obj : simulation.m_gameObjects)
+            obj->rotation = QVector3D(obj->position.x(), 30.0f, obj->position.z());
+        results.push_back(measure("render/modelMatrix", qint64(simulation.m_gameObjects.size()), [&simulation]()
+        {
+            float sum = 0.0f;
+            for(const GameObject* obj : simulation.m_gameObjects)
+                sum += obj->modelMatrix()(0, 3);
+            sink = sum;
+        }));
+        simulation.clear();
+    }
+
+    for(int count : { 100, 500, 2000 })
+    {
+        Simulation simulation;
+        simulation.populateGrid(count);
+        results.push_back(measure(QString("simulation/step/%1").arg(count), 1, [&simulation]()
+        {
+            simulation.step();
+        }));
+        simulation.clear();
+    }
+
+    // the same worlds with a view in one corner, the far objects share a fixed budget
+    for(int count : { 2000, 10000 })
+    {
+        Simulation simulation;
+        simulation.populateGrid(count);
+        simulation.addLodView(QVector3D(0.0f, 0.0f, 0.0f));
+        results.push_back(measure(QString("simulation/stepLod/%1").arg(count), 1, [&simulation]()
+        {
+            simulation.step();
+        }));
+        simulation.clear();
+    }
+
+    const int objects = 10000;
+    {
+        std::vector<Bullet> bullets(objects);
+        results.push_back(measure("object/Bullet::update", objects, [&bullets]()
+        {
+            // the energy is topped up so every update takes the same path
+            for(Bullet& bullet : bullets)
+            {
+                bullet.energy = QVector3D(1.0f, 0.0f, 0.0f);
+                bullet.update();
+            }
+        }));
+    }
+    {
+        std::vector<Cube> cubes(objects);
+        results.push_back(measure("object/Cube::update", objects, [&cubes]()
+        {
+            for(Cube& cube : cubes)
+            {
+                cube.energy = QVector3D(1.0f, 0.0f, 0.0f);
+                cube.update();
+            }
+        }));
+    }
+
+    // once warmed up a tick must not touch the heap, transient data goes into the tick arena
+    int allocationFailures = 0;
+    QJsonObject allocations;
+    for(const AllocationCheck::Result& result : AllocationCheck::measure())
+    {
+        cout << "  " << result.name.toStdString() << ": " << result.allocations << " allocations in "
+             << result.iterations << " iterations" << (result.allocations > 0 ? " FAILED" : "") << endl;
+        allocations[result.name] = double(result.allocations);
+        if(result.allocations > 0)
+            allocationFailures++;
+    }
+
+    QJsonArray entries;
+    for(const Result& result : results)
+    {
+        QJsonObject entry;
+        entry["name"] = result.name;
+        entry["ns_per_op"] = result.nsPerOp;
+        entry["operations"] = double(result.operations);
+        entries.append(entry);
+    }
+    QJsonObject root;
+    root["benchmarks"] = entries;
+    root["allocations"] = allocations;
+
+    if(!output.isEmpty())
+    {
+        QFile file(output);
+        if(!file.open(QFile::WriteOnly))
+        {
+            cout << "Saving " << output.toStdString() << " - Failed!" << endl;
+            return 1;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    if(baseline.isEmpty())
+        return allocationFailures > 0 ? 1 : 0;
+
+    QFile file(baseline);
+    if(!file.open(QFile::ReadOnly))
+    {
+        cout << "Loading " << baseline.toStdString() << " - Not Found!" << endl;
+        return 1;
+    }
+    QJsonArray previous = QJsonDocument::fromJson(file.readAll()).object()["benchmarks"].toArray();
+
+    int regressions = 0;
+    cout << "compared with " << baseline.toStdString() << ", tolerance " << tolerance * 100 << "%" << endl;
+    for(const Result& result : results)
+    {
+        for(const QJsonValue& value : previous)
+        {
+            QJsonObject entry = value.toObject();
+            if(entry["name"].toString() != result.name)
+                continue;
+
+            double before = entry["ns_per_op"].toDouble();
+            double change = before > 0.0 ? result.nsPerOp / before - 1.0 : 0.0;
+            bool regressed = change > tolerance;
+            if(regressed)
+                regressions++;
+            cout << "  " << result.name.toStdString() << ": " << (change >= 0 ? "+" : "") << change * 100 << "%"
+                 << (regressed ? " REGRESSION" : "") << endl;
+            break;
+        }
+    }
+    cout << regressions << " regressions" << endl;
+
+    return regressions > 0 || allocationFailures > 0 ? 1 : 0;
+}
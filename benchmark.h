@@ -0,0 +1,19 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+
+// headless benchmarks, selected from the command line in main()
+namespace Benchmark
+{
+    int particles();
+    int network(int clients, int seconds);
+    int saveLoad(int objects);
+
+    // micro benchmarks of the hot paths, written as JSON to output when given;
+    // returns nonzero when a result is slower than baseline by more than tolerance
+    // or when a steady state tick allocated
+    int suite(const QString& output, const QString& baseline, double tolerance);
+}
+
+#endif // BENCHMARK_H
@@ -0,0 +1,9 @@
+uniform highp vec3 color;
+varying highp float fade;
+
+void main() {
+    highp vec2 d = gl_PointCoord - vec2(0.5, 0.5);
+    if(dot(d, d) > 0.25)
+        discard;
+    gl_FragColor = vec4(color * fade, 1.0);
+}
@@ -0,0 +1,16 @@
+attribute float px;
+attribute float py;
+attribute float pz;
+attribute float life;
+uniform mat4 projMatrix;
+uniform mat4 viewMatrix;
+uniform highp float lifetime;
+uniform highp float pointSize;
+varying highp float fade;
+
+void main() {
+    vec4 viewPos = viewMatrix * vec4(px, py, pz, 1.0);
+    fade = clamp(life / lifetime, 0.0, 1.0);
+    gl_Position = projMatrix * viewPos;
+    gl_PointSize = pointSize * fade / max(-viewPos.z, 0.1);
+}
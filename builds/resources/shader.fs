@@ -1,6 +1,25 @@
+#ifdef MULTI_DRAW
+varying highp vec4 fragColor;
+varying highp vec4 fragMaterial;
+#define MODEL_COLOR fragColor.rgb
+#define HAS_TEXTURE (fragColor.a > 0.5)
+#define MATERIAL_LAYER (fragColor.a - 1.0)
+#define MATERIAL_RECT fragMaterial
+#else
 uniform highp vec3 modelColor;
 uniform highp int hasTexture;
+uniform highp float materialLayer;
+uniform highp vec4 materialRect;
+#define MODEL_COLOR modelColor
+#define HAS_TEXTURE (hasTexture == 1)
+#define MATERIAL_LAYER materialLayer
+#define MATERIAL_RECT materialRect
+#endif
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray materials;
+#else
 uniform sampler2D texture;
+#endif
 varying highp vec3 fragNormal;
 varying highp vec3 vertexWorldSpace;
 varying highp vec2 fragUV;
@@ -12,16 +31,68 @@ struct Light {
 };
 uniform Light light;
 
+#ifdef CLUSTERED
+// lightData: MAX_LIGHTS x 2, view space position + radius, color
+// clusterData: one texel per cluster, offset and count into lightIndices
+// lightIndices: light numbers packed 4 per texel
+uniform mat4 viewMatrix;
+uniform sampler2D lightData;
+uniform sampler2D clusterData;
+uniform sampler2D lightIndices;
+uniform highp vec2 viewportSize;
+uniform highp float clusterScale;
+uniform highp float clusterBias;
+varying highp vec3 vertexViewSpace;
+
+highp vec3 clusteredLights(highp vec3 N)
+{
+    highp vec2 tile = floor(gl_FragCoord.xy / viewportSize * vec2(TILES_X, TILES_Y));
+    tile = clamp(tile, vec2(0.0), vec2(TILES_X - 1.0, TILES_Y - 1.0));
+    highp float slice = floor(log(-vertexViewSpace.z) * clusterScale - clusterBias);
+    slice = clamp(slice, 0.0, SLICES - 1.0);
+    highp vec4 cluster = texture2D(clusterData, vec2((tile.y * TILES_X + tile.x + 0.5) / (TILES_X * TILES_Y), (slice + 0.5) / SLICES));
+
+    highp vec3 result = vec3(0.0);
+    for(int i = 0; i < MAX_LIGHTS_PER_CLUSTER; i++)
+    {
+        if(float(i) >= cluster.y)
+            break;
+        highp float k = cluster.x + float(i);
+        highp float texel = floor(k / 4.0);
+        highp vec4 indices = texture2D(lightIndices, vec2((mod(texel, INDEX_WIDTH) + 0.5) / INDEX_WIDTH, (floor(texel / INDEX_WIDTH) + 0.5) / INDEX_HEIGHT));
+        highp float index = dot(indices, vec4(equal(vec4(k - texel * 4.0), vec4(0.0, 1.0, 2.0, 3.0))));
+
+        highp vec4 positionRadius = texture2D(lightData, vec2((index + 0.5) / MAX_LIGHTS, 0.25));
+        highp vec3 color = texture2D(lightData, vec2((index + 0.5) / MAX_LIGHTS, 0.75)).rgb;
+        highp vec3 L = positionRadius.xyz - vertexViewSpace;
+        highp float d = length(L);
+        highp float attenuation = clamp(1.0 - d / positionRadius.w, 0.0, 1.0);
+        result += color * attenuation * attenuation * clamp(dot(N, L / max(d, 0.0001)), 0.0, 1.0);
+    }
+    return result;
+}
+#endif
+
 void main() {
+    highp vec3 baseColor = MODEL_COLOR;
     highp vec3 N = normalize(fragNormal);
     highp vec3 L = normalize(light.position - vertexWorldSpace);
     highp float cosNL = dot(N, L);
     cosNL = clamp(cosNL, 0.0, 1.0);
-    highp vec3 colorAmb = modelColor * light.ambient;
-    highp vec3 colorDif = modelColor * light.diffuse * cosNL;
+    highp vec3 colorAmb = baseColor * light.ambient;
+    highp vec3 colorDif = baseColor * light.diffuse * cosNL;
+#ifdef CLUSTERED
+    colorDif += baseColor * clusteredLights(normalize((viewMatrix * vec4(N, 0.0)).xyz));
+#endif
     highp vec3 colorFull = clamp(colorAmb + colorDif, 0.0, 1.0);
+#ifdef TEXTURE_ARRAY
+    // whole layers repeat in the sampler, atlas entries wrap inside their rect
+    highp vec2 uv = MATERIAL_RECT.z < 1.0 ? MATERIAL_RECT.xy + fract(fragUV) * MATERIAL_RECT.zw : fragUV;
+    highp vec3 tex = texture2DArray(materials, vec3(uv, MATERIAL_LAYER)).xyz;
+#else
     highp vec3 tex = texture2D(texture,fragUV).xyz;
-    if(hasTexture == 1)
+#endif
+    if(HAS_TEXTURE)
     {
         gl_FragColor = vec4(colorFull*tex, 1.0);
     }
@@ -3,12 +3,25 @@ attribute vec3 normal;
 attribute vec2 uvCoord;
 uniform mat4 projMatrix;
 uniform mat4 viewMatrix;
+#ifdef MULTI_DRAW
+// per draw data, one instance per indirect command
+attribute vec4 drawModel0;
+attribute vec4 drawModel1;
+attribute vec4 drawModel2;
+attribute vec4 drawModel3;
+attribute vec4 drawColor;
+attribute vec4 drawMaterial;
+varying highp vec4 fragColor;
+varying highp vec4 fragMaterial;
+#else
 uniform mat4 modelMatrix;
-uniform highp int hasTexture;
-uniform sampler2D texture;
+#endif
 varying highp vec3 fragNormal;
 varying highp vec3 vertexWorldSpace;
 varying highp vec2 fragUV;
+#ifdef CLUSTERED
+varying highp vec3 vertexViewSpace;
+#endif
 
 struct Light {
     highp vec3 position;
@@ -18,8 +31,16 @@ struct Light {
 uniform Light light;
 
 void main() {
+#ifdef MULTI_DRAW
+    mat4 modelMatrix = mat4(drawModel0, drawModel1, drawModel2, drawModel3);
+    fragColor = drawColor;
+    fragMaterial = drawMaterial;
+#endif
     fragNormal = (modelMatrix*vec4(normal,0)).xyz;
     fragUV = uvCoord;
     vertexWorldSpace = (modelMatrix * vertex).xyz;
+#ifdef CLUSTERED
+    vertexViewSpace = (viewMatrix * vec4(vertexWorldSpace, 1.0)).xyz;
+#endif
     gl_Position = projMatrix * viewMatrix * modelMatrix * vertex;
 }
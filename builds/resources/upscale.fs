@@ -0,0 +1,17 @@
+uniform sampler2D scene;
+uniform highp vec2 uvMin;
+uniform highp vec2 uvMax;
+uniform highp vec2 texelSize;
+uniform highp float sharpness;
+varying highp vec2 uv;
+
+highp vec3 fetch(highp vec2 p) {
+    return texture2D(scene, clamp(p, uvMin, uvMax)).rgb;
+}
+
+void main() {
+    highp vec3 center = fetch(uv);
+    highp vec3 neighbours = fetch(uv + vec2(texelSize.x, 0.0)) + fetch(uv - vec2(texelSize.x, 0.0))
+                          + fetch(uv + vec2(0.0, texelSize.y)) + fetch(uv - vec2(0.0, texelSize.y));
+    gl_FragColor = vec4(clamp(center + (4.0 * center - neighbours) * sharpness, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,8 @@
+attribute vec2 corner;
+uniform highp vec2 uvScale;
+varying highp vec2 uv;
+
+void main() {
+    uv = (corner * 0.5 + 0.5) * uvScale;
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
@@ -2,12 +2,14 @@
 
 Bullet::Bullet()
 {
-
+    m_name = "bullet";
+    setLayer(Collision::BulletLayer);
 }
 
 void Bullet::init()
 {
-    m_mesh=CMesh::m_meshes["sphere"];
+    static const AssetName mesh("sphere");
+    m_mesh=CMesh::find(mesh);
     //scale=QVector3D(0.5f,0.5f,0.5f);
     //m_radius=0.5f;
 }
@@ -15,7 +17,6 @@ void Bullet::init()
 void Bullet::render(GLWidget *glwidget)
 {
     m_mesh->render(glwidget);
-    m_name="bullet";
 }
 
 void Bullet::update()
@@ -31,3 +32,8 @@ void Bullet::update()
         isAlive=false;
     }
 }
+
+GameObject::Type Bullet::type() const
+{
+    return BulletType;
+}
@@ -12,8 +12,7 @@ public:
     void init();
     void render(GLWidget* glwidget);
     void update();
-
-    CMesh* m_mesh;
+    Type type() const;
 };
 
 #endif // BULLET_H
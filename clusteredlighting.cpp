@@ -0,0 +1,242 @@
+#include "clusteredlighting.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QtConcurrent>
+#include <QtMath>
+#include <math.h>
+
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+
+using namespace std;
+
+ClusteredLighting::ClusteredLighting()
+    : m_supported(false), m_zNear(0.01f), m_zFar(100.0f)
+{
+    m_textures[0] = m_textures[1] = m_textures[2] = 0;
+
+    m_clusterBounds.resize(ClusterCount);
+    m_sliceDepth.resize(Slices + 1);
+    for(int s = 0; s < Slices; s++)
+        m_sliceIds.append(s);
+
+    m_lights.reserve(MaxLights);
+    m_viewLights.resize(MaxLights * 4);
+    m_lightTexels.resize(MaxLights * 2 * 4);
+    m_clusterCounts.resize(ClusterCount);
+    m_clusterLights.resize(ClusterCount * MaxLightsPerCluster);
+    m_clusterTexels.resize(ClusterCount * 4);
+    m_indices.resize(MaxIndices);
+}
+
+bool ClusteredLighting::initGL()
+{
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    QOpenGLFunctions *f = context->functions();
+
+    // float textures sampled with GL_NEAREST
+    if(context->isOpenGLES())
+        m_supported = context->format().majorVersion() >= 3;
+    else
+        m_supported = context->format().majorVersion() >= 3 || context->hasExtension("GL_ARB_texture_float");
+    if(!m_supported)
+        return false;
+
+    const int sizes[3][2] = {
+        { MaxLights, 2 },
+        { TilesX * TilesY, Slices },
+        { IndexTextureWidth, IndexTextureHeight }
+    };
+
+    f->glGenTextures(3, m_textures);
+    for(int t = 0; t < 3; t++)
+    {
+        f->glBindTexture(GL_TEXTURE_2D, m_textures[t]);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, sizes[t][0], sizes[t][1], 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void ClusteredLighting::cleanupGL()
+{
+    if(m_textures[0] == 0)
+        return;
+    QOpenGLContext::currentContext()->functions()->glDeleteTextures(3, m_textures);
+    m_textures[0] = m_textures[1] = m_textures[2] = 0;
+}
+
+QByteArray ClusteredLighting::shaderDefines() const
+{
+    if(!m_supported)
+        return QByteArray();
+
+    return QByteArray("#define CLUSTERED\n")
+            + "#define TILES_X " + QByteArray::number(TilesX) + ".0\n"
+            + "#define TILES_Y " + QByteArray::number(TilesY) + ".0\n"
+            + "#define SLICES " + QByteArray::number(Slices) + ".0\n"
+            + "#define MAX_LIGHTS " + QByteArray::number(MaxLights) + ".0\n"
+            + "#define MAX_LIGHTS_PER_CLUSTER " + QByteArray::number(MaxLightsPerCluster) + "\n"
+            + "#define INDEX_WIDTH " + QByteArray::number(IndexTextureWidth) + ".0\n"
+            + "#define INDEX_HEIGHT " + QByteArray::number(IndexTextureHeight) + ".0\n";
+}
+
+void ClusteredLighting::setProjection(float fovY, float aspect, float zNear, float zFar)
+{
+    m_zNear = zNear;
+    m_zFar = zFar;
+
+    for(int s = 0; s <= Slices; s++)
+        m_sliceDepth[s] = zNear * pow(zFar / zNear, float(s) / Slices);
+
+    float tanY = tan(qDegreesToRadians(fovY * 0.5f));
+    float tanX = tanY * aspect;
+
+    // view space AABB of every cluster, the camera looks down -z
+    for(int s = 0; s < Slices; s++)
+    {
+        float d0 = m_sliceDepth[s];
+        float d1 = m_sliceDepth[s + 1];
+        for(int ty = 0; ty < TilesY; ty++)
+        {
+            for(int tx = 0; tx < TilesX; tx++)
+            {
+                float x0 = -1.0f + 2.0f * tx / TilesX;
+                float x1 = -1.0f + 2.0f * (tx + 1) / TilesX;
+                float y0 = -1.0f + 2.0f * ty / TilesY;
+                float y1 = -1.0f + 2.0f * (ty + 1) / TilesY;
+
+                Bounds& b = m_clusterBounds[(s * TilesY + ty) * TilesX + tx];
+                b.min = QVector3D(qMin(x0 * tanX * d0, x0 * tanX * d1), qMin(y0 * tanY * d0, y0 * tanY * d1), -d1);
+                b.max = QVector3D(qMax(x1 * tanX * d0, x1 * tanX * d1), qMax(y1 * tanY * d0, y1 * tanY * d1), -d0);
+            }
+        }
+    }
+}
+
+void ClusteredLighting::clearLights()
+{
+    m_lights.resize(0);
+}
+
+void ClusteredLighting::addLight(const PointLight &light)
+{
+    if(m_lights.size() < MaxLights)
+        m_lights.append(light);
+}
+
+void ClusteredLighting::assignSlice(int slice)
+{
+    float sliceNear = m_sliceDepth[slice];
+    float sliceFar = m_sliceDepth[slice + 1];
+    int first = slice * TilesX * TilesY;
+
+    for(int c = first; c < first + TilesX * TilesY; c++)
+        m_clusterCounts[c] = 0;
+
+    for(int l = 0; l < m_lights.size(); l++)
+    {
+        const float* light = &m_viewLights[l * 4];
+        float depth = -light[2];
+        float radius = light[3];
+        if(depth + radius < sliceNear || depth - radius > sliceFar)
+            continue;
+
+        for(int c = first; c < first + TilesX * TilesY; c++)
+        {
+            const Bounds& b = m_clusterBounds[c];
+            float dx = qMax(b.min.x() - light[0], qMax(0.0f, light[0] - b.max.x()));
+            float dy = qMax(b.min.y() - light[1], qMax(0.0f, light[1] - b.max.y()));
+            float dz = qMax(b.min.z() - light[2], qMax(0.0f, light[2] - b.max.z()));
+            if(dx * dx + dy * dy + dz * dz > radius * radius)
+                continue;
+
+            int& count = m_clusterCounts[c];
+            if(count < MaxLightsPerCluster)
+                m_clusterLights[c * MaxLightsPerCluster + count++] = float(l);
+        }
+    }
+}
+
+void ClusteredLighting::update(const QMatrix4x4 &view)
+{
+    if(!m_supported)
+        return;
+
+    for(int l = 0; l < m_lights.size(); l++)
+    {
+        const PointLight& light = m_lights[l];
+        QVector3D p = view.map(light.position);
+        float* v = &m_viewLights[l * 4];
+        v[0] = p.x();
+        v[1] = p.y();
+        v[2] = p.z();
+        v[3] = light.radius;
+
+        float* position = &m_lightTexels[l * 4];
+        float* color = &m_lightTexels[(MaxLights + l) * 4];
+        position[0] = p.x();
+        position[1] = p.y();
+        position[2] = p.z();
+        position[3] = light.radius;
+        color[0] = light.color.x();
+        color[1] = light.color.y();
+        color[2] = light.color.z();
+        color[3] = 1.0f;
+    }
+
+    // every slice writes only its own clusters
+    if(m_lights.size() > 16)
+        QtConcurrent::blockingMap(m_sliceIds, [this](int slice) { assignSlice(slice); });
+    else
+        for(int s = 0; s < Slices; s++)
+            assignSlice(s);
+
+    int offset = 0;
+    for(int c = 0; c < ClusterCount; c++)
+    {
+        int count = qMin(m_clusterCounts[c], MaxIndices - offset);
+        memcpy(&m_indices[offset], &m_clusterLights[c * MaxLightsPerCluster], size_t(count) * sizeof(float));
+        m_clusterTexels[c * 4] = float(offset);
+        m_clusterTexels[c * 4 + 1] = float(count);
+        offset += count;
+    }
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glBindTexture(GL_TEXTURE_2D, m_textures[0]);
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, MaxLights, 2, GL_RGBA, GL_FLOAT, m_lightTexels.constData());
+    f->glBindTexture(GL_TEXTURE_2D, m_textures[1]);
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TilesX * TilesY, Slices, GL_RGBA, GL_FLOAT, m_clusterTexels.constData());
+
+    int rows = qMax(1, (offset + IndexTextureWidth * 4 - 1) / (IndexTextureWidth * 4));
+    f->glBindTexture(GL_TEXTURE_2D, m_textures[2]);
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, IndexTextureWidth, rows, GL_RGBA, GL_FLOAT, m_indices.constData());
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ClusteredLighting::bind(QOpenGLShaderProgram *program, float viewportWidth, float viewportHeight)
+{
+    if(!m_supported)
+        return;
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    const char* samplers[3] = { "lightData", "clusterData", "lightIndices" };
+    for(int t = 0; t < 3; t++)
+    {
+        f->glActiveTexture(GL_TEXTURE1 + t);
+        f->glBindTexture(GL_TEXTURE_2D, m_textures[t]);
+        program->setUniformValue(samplers[t], 1 + t);
+    }
+    f->glActiveTexture(GL_TEXTURE0);
+
+    float scale = Slices / log(m_zFar / m_zNear);
+    program->setUniformValue("viewportSize", viewportWidth, viewportHeight);
+    program->setUniformValue("clusterScale", scale);
+    program->setUniformValue("clusterBias", log(m_zNear) * scale);
+}
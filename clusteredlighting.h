@@ -0,0 +1,80 @@
+#ifndef CLUSTEREDLIGHTING_H
+#define CLUSTEREDLIGHTING_H
+
+#include <QVector3D>
+#include <QMatrix4x4>
+#include <QVector>
+#include <QByteArray>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+
+struct PointLight
+{
+    QVector3D position;
+    float radius;
+    QVector3D color;
+};
+
+// clustered forward shading: the view frustum is split into TilesX x TilesY x Slices
+// clusters (exponential depth slices), every frame the point lights are assigned to
+// the clusters they touch on the CPU and the lists are uploaded as float textures
+class ClusteredLighting
+{
+public:
+    static const int TilesX = 16;
+    static const int TilesY = 9;
+    static const int Slices = 24;
+    static const int ClusterCount = TilesX * TilesY * Slices;
+    static const int MaxLights = 512;
+    static const int MaxLightsPerCluster = 64;
+    static const int IndexTextureWidth = 1024;
+    static const int IndexTextureHeight = 8;
+    static const int MaxIndices = IndexTextureWidth * IndexTextureHeight * 4;
+
+    ClusteredLighting();
+
+    bool initGL();
+    void cleanupGL();
+    bool isSupported() const { return m_supported; }
+
+    // preprocessor definitions the shaders are compiled with
+    QByteArray shaderDefines() const;
+
+    void setProjection(float fovY, float aspect, float zNear, float zFar);
+
+    void clearLights();
+    void addLight(const PointLight& light);
+    int lightCount() const { return m_lights.size(); }
+
+    void update(const QMatrix4x4& view);
+    void bind(QOpenGLShaderProgram* program, float viewportWidth, float viewportHeight);
+
+private:
+    struct Bounds
+    {
+        QVector3D min;
+        QVector3D max;
+    };
+
+    void assignSlice(int slice);
+
+    bool m_supported;
+    GLuint m_textures[3];
+
+    float m_zNear;
+    float m_zFar;
+    QVector<Bounds> m_clusterBounds;
+    QVector<float> m_sliceDepth;
+    QVector<int> m_sliceIds;
+
+    QVector<PointLight> m_lights;
+    QVector<float> m_viewLights;        // x, y, z, radius in view space
+    QVector<float> m_lightTexels;       // MaxLights x 2 RGBA
+    QVector<int> m_clusterCounts;
+    QVector<float> m_clusterLights;     // ClusterCount x MaxLightsPerCluster
+    QVector<float> m_clusterTexels;     // ClusterCount RGBA: offset, count
+    QVector<float> m_indices;           // packed 4 per texel
+};
+
+#endif // CLUSTEREDLIGHTING_H
@@ -1,63 +1,115 @@
 #include "cmesh.h"
 #include "glwidget.h"
+#include "procedural.h"
 #include <qmath.h>
 #include <iostream>
 #include <QFile>
 #include <QTextStream>
 #include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
 
 using namespace std;
 
 CMesh::CMesh()
-    : m_count(0), m_primitive(0)
+    : m_count(0), m_stride(0), m_primitive(0), m_quantized(false), m_boundingRadius(0.0f),
+      m_ibo(QOpenGLBuffer::IndexBuffer), m_vao_binder(nullptr)
 {
 }
 
 CMesh::~CMesh()
 {
     m_vbo.destroy();
+    m_ibo.destroy();
     delete m_vao_binder;
 }
 
 void CMesh::add(const QVector3D &v, const QVector3D &n, const QVector2D &uv)
 {
-    m_data.append(v.x());
-    m_data.append(v.y());
-    m_data.append(v.z());
-    m_data.append(n.normalized().x());
-    m_data.append(n.normalized().y());
-    m_data.append(n.normalized().z());
-    m_data.append(uv.x());
-    m_data.append(uv.y());
+    StagingVertex vertex;
+    vertex.position = v;
+    vertex.normal = n.normalized();
+    vertex.uv = uv;
+    m_vertices.append(vertex);
     m_count++;
 }
 
+CMesh::StagingVertex *CMesh::stageVertices(int count)
+{
+    m_vertices.resize(count);
+    m_count = count;
+    return m_vertices.data();
+}
+
+GLuint *CMesh::stageIndices(int count)
+{
+    m_indices.resize(count);
+    return m_indices.data();
+}
+
+bool CMesh::packedFormatsSupported()
+{
+    // 2_10_10_10 normals need GL 3.3 or GLES 3.0
+    QSurfaceFormat format = QOpenGLContext::currentContext()->format();
+    if(QOpenGLContext::currentContext()->isOpenGLES())
+        return format.majorVersion() >= 3;
+    return format.version() >= qMakePair(3, 3);
+}
+
+bool CMesh::hasTiledUvs() const
+{
+    for(const StagingVertex& v : m_vertices)
+    {
+        if(v.uv.x() < 0.0f || v.uv.x() > 1.0f || v.uv.y() < 0.0f || v.uv.y() > 1.0f)
+            return true;
+    }
+    return false;
+}
+
 void CMesh::initVboAndVao()
 {
-    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
-    int dataSize = m_data.size() * int(sizeof(GLfloat));
+    if(!packedFormatsSupported())
+        initVboAndVao<VertexP3fN3fT2f>();
+    else if(hasTiledUvs())
+        initVboAndVao<VertexP3fN10T2h>();
+    else
+        initVboAndVao<VertexP3sN10T2us>();
+}
 
-    m_vao.create(); // creates vertex array object
-    m_vao_binder = new QOpenGLVertexArrayObject::Binder(&m_vao); // binds vertex array object
-    m_vbo.create(); // creates vertex buffer object
-    m_vbo.bind(); // binds vertex buffer object
-    m_vbo.allocate(constData(), dataSize); // copies mesh data to vertex buffer object
+Dequantization CMesh::computeDequantization() const
+{
+    Dequantization dq;
+    if(m_vertices.isEmpty())
+        return dq;
 
-    f->glEnableVertexAttribArray(0);
-    f->glEnableVertexAttribArray(1);
-    f->glEnableVertexAttribArray(2);
-    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), nullptr);
-    f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
-    f->glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));
+    QVector3D lo = m_vertices[0].position;
+    QVector3D hi = lo;
+    for(const StagingVertex& v : m_vertices)
+    {
+        lo = QVector3D(qMin(lo.x(), v.position.x()), qMin(lo.y(), v.position.y()), qMin(lo.z(), v.position.z()));
+        hi = QVector3D(qMax(hi.x(), v.position.x()), qMax(hi.y(), v.position.y()), qMax(hi.z(), v.position.z()));
+    }
+
+    // uniform scale keeps normals transformed by modelMatrix undistorted
+    QVector3D extent = (hi - lo) * 0.5f;
+    dq.offset = (hi + lo) * 0.5f;
+    dq.scale = qMax(extent.x(), qMax(extent.y(), extent.z()));
+    if(dq.scale <= 0.0f)
+        dq.scale = 1.0f;
+    return dq;
 }
 
 void CMesh::render(GLWidget* glWidget)
 {
+    if(m_quantized)
+        glWidget->m_program->setUniformValue(glWidget->m_modelMatrixLoc, glWidget->m_world * m_dequantization);
     m_vao_binder->rebind();
-    glWidget->glDrawArrays(m_primitive, 0, vertexCount());
+    if(isIndexed())
+        glWidget->glDrawElements(m_primitive, indexCount(), GL_UNSIGNED_INT, nullptr);
+    else
+        glWidget->glDrawArrays(m_primitive, 0, vertexCount());
 }
 
-std::map<std::string, CMesh *> CMesh::m_meshes;
+std::vector<CMesh::Handle> CMesh::m_loaded;
 
 void CMesh::loadAllMeshes()
 {
@@ -65,87 +117,36 @@ void CMesh::loadAllMeshes()
 
     mesh=new CMesh;
     mesh->generateCube(1.0f,1.0f,1.0f);
-    m_meshes["cube"]=mesh;
+    mesh->initVboAndVao();
+    m_loaded.push_back(registry().add(AssetName("cube"), mesh));
 
     mesh=new CMesh;
     mesh->generateSphere(0.5f,24);
-    m_meshes["sphere"]=mesh;
+    mesh->initVboAndVao();
+    m_loaded.push_back(registry().add(AssetName("sphere"), mesh));
 
     mesh=new CMesh;
     mesh->generateMeshFromObjFile("resources/bunny.obj");
-    m_meshes["bunny"]=mesh;
+    mesh->initVboAndVao();
+    m_loaded.push_back(registry().add(AssetName("bunny"), mesh));
 }
 
-void CMesh::quad3(GLfloat x1, GLfloat y1, GLfloat z1,
-                 GLfloat x2, GLfloat y2, GLfloat z2,
-                 GLfloat x3, GLfloat y3, GLfloat z3,
-                 GLfloat x4, GLfloat y4, GLfloat z4)
+void CMesh::unloadAllMeshes()
 {
-    QVector3D n = QVector3D::normal(QVector3D(x4 - x1, y4 - y1, z4 - z1), QVector3D(x2 - x1, y2 - y1, z2 - z1));
-
-    add(QVector3D(x1, y1, z1), n, QVector2D(0,1));
-    add(QVector3D(x4, y4, z4), n, QVector2D(1,1));
-    add(QVector3D(x2, y2, z2), n, QVector2D(0,0));
-
-    add(QVector3D(x3, y3, z3), n, QVector2D(1,0));
-    add(QVector3D(x2, y2, z2), n, QVector2D(0,0));
-    add(QVector3D(x4, y4, z4), n, QVector2D(1,1));
+    // meshes still used by objects stay until those are gone and the registry collects
+    for(Handle handle : m_loaded)
+        registry().release(handle);
+    m_loaded.clear();
 }
 
 void CMesh::generateCube(GLfloat w, GLfloat h, GLfloat d)
 {
-    quad3(-w/2, -h/2, -d/2,  +w/2, -h/2, -d/2,  +w/2, +h/2, -d/2,  -w/2, +h/2, -d/2);
-    quad3(-w/2, -h/2, +d/2,  -w/2, +h/2, +d/2,  +w/2, +h/2, +d/2,  +w/2, -h/2, +d/2);
-
-    quad3(-w/2, -h/2, -d/2,  -w/2, -h/2, +d/2,  +w/2, -h/2, +d/2,  +w/2, -h/2, -d/2);
-    quad3(-w/2, +h/2, -d/2,  +w/2, +h/2, -d/2,  +w/2, +h/2, +d/2,  -w/2, +h/2, +d/2);
-
-    quad3(+w/2, -h/2, -d/2,  +w/2, -h/2, +d/2,  +w/2, +h/2, +d/2,  +w/2, +h/2, -d/2);
-    quad3(-w/2, -h/2, -d/2,  -w/2, +h/2, -d/2,  -w/2, +h/2, +d/2,  -w/2, -h/2, +d/2);
-
-    m_primitive = GL_TRIANGLES;
-
-    initVboAndVao();
+    Procedural::box(*this, QVector3D(w, h, d));
 }
 
 void CMesh::generateSphere(float r, int N)
 {
-    for(int j = 0 ; j <= N ; j++)
-    {
-        for(int i = 0 ; i < N ; i++)
-        {
-             float theta1 = 3.14f * float(j) / float(N);
-             float theta2 = 3.14f * float(j-1) / float(N);
-             float phi = 3.14f * 2 * float(i) / float(N);
-
-             float nx1 = sin(theta1) * cos(phi);
-             float nx2 = sin(theta2) * cos(phi);
-             float nz1 = sin(theta1) * sin(phi);
-             float nz2 = sin(theta2) * sin(phi);
-             float ny1 = cos(theta1);
-             float ny2 = cos(theta2);
-
-             float x1 = r * nx1;
-             float x2 = r * nx2;
-             float y1 = r * ny1;
-             float y2 = r * ny2;
-             float z1 = r * nz1;
-             float z2 = r * nz2;
-
-             float u1 = 0.5 + atan2(nz1, nx1)/(2*M_PI);
-             float v1 = 0.5 + asin(ny1)/M_PI;
-
-             float u2 = 0.5 + atan2(nz2, nx2)/(2*M_PI);
-             float v2 = 0.5 + asin(ny2)/M_PI;
-
-            add(QVector3D(x1, y1, z1), QVector3D(nx1, ny1, nz1), QVector2D(u1, v1));
-            add(QVector3D(x2, y2, z2), QVector3D(nx2, ny2, nz2), QVector2D(u2, v2));
-        }
-    }
-
-    m_primitive = GL_TRIANGLE_STRIP;
-
-    initVboAndVao();
+    Procedural::sphere(*this, r, N, N);
 }
 
 void CMesh::generateMeshFromObjFile(QString filename)
@@ -155,6 +156,11 @@ void CMesh::generateMeshFromObjFile(QString filename)
 
     std::cout << "Loading " << filename.toStdString() << " - " << (file.isOpen() ? "Found!" : "Not Found!") << std::endl;
 
+    generateMeshFromObj(file);
+}
+
+void CMesh::generateMeshFromObj(QIODevice &device)
+{
     QVector<QVector3D> vertices;
     QVector<QVector3D> normals;
     QVector<QVector2D> texCoords;
@@ -162,7 +168,7 @@ void CMesh::generateMeshFromObjFile(QString filename)
     bool hasNormals = false;
     bool hasTexCoords = false;
 
-    QTextStream stream(&file);
+    QTextStream stream(&device);
 
     while (!stream.atEnd()) {
         QString line = stream.readLine();
@@ -213,6 +219,4 @@ void CMesh::generateMeshFromObjFile(QString filename)
     }
 
     m_primitive = GL_TRIANGLES;
-
-    initVboAndVao();
 }
@@ -2,50 +2,148 @@
 #define CMesh_H
 
 #include <qopengl.h>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLBuffer>
+#include <QMatrix4x4>
+#include <QByteArray>
 #include <QVector>
 #include <QVector2D>
 #include <QVector3D>
+#include <QIODevice>
+#include "vertexformat.h"
+#include "assetregistry.h"
 
 class GLWidget;
 
 class CMesh
 {
 public:
+    struct StagingVertex
+    {
+        QVector3D position;
+        QVector3D normal;
+        QVector2D uv;
+    };
+
     CMesh();
     ~CMesh();
-    const GLfloat *constData() const { return m_data.constData(); }
+    const char *constData() const { return m_data.constData(); }
     int vertexCount() const { return m_count; }
-    GLenum primitive() {return m_primitive; }
+    // indexed meshes draw with glDrawElements, the rest with glDrawArrays
+    bool isIndexed() const { return !m_indices.isEmpty(); }
+    int indexCount() const { return m_indices.size(); }
+    const GLuint *constIndexData() const { return m_indices.constData(); }
+    int stride() const { return m_stride; }
+    GLenum primitive() const { return m_primitive; }
+    const QMatrix4x4& dequantization() const { return m_dequantization; }
+    const std::array<VertexAttribute, 3>& attributes() const { return m_attributes; }
+    // distance of the farthest vertex from the mesh origin
+    float boundingRadius() const { return m_boundingRadius; }
 
+    // generating only fills the staging vertices, initVboAndVao packs and uploads them
     void generateCube(GLfloat ww, GLfloat hh, GLfloat dd);
     void generateSphere(float r, int N);
     void generateMeshFromObjFile(QString filename);
+    void generateMeshFromObj(QIODevice& device);
+
+    void add(const QVector3D &v, const QVector3D &n, const QVector2D &uv);
+
+    // pre-sized staging for generators that fill vertices and indices in place,
+    // normals have to be unit length already
+    StagingVertex* stageVertices(int count);
+    GLuint* stageIndices(int count);
+    void setPrimitive(GLenum primitive) { m_primitive = primitive; }
 
     void initVboAndVao();
+    template<typename Vertex> void initVboAndVao();
+
+    static bool packedFormatsSupported();
 
     void render(GLWidget* glWidget);
 
-    static std::map<std::string, CMesh *> m_meshes;
+    typedef AssetHandle<CMesh> Handle;
+    static AssetRegistry<CMesh>& registry() { return AssetRegistry<CMesh>::instance(); }
+    static Handle find(const AssetName& name) { return registry().find(name); }
+
+    // the built in meshes, loaded holds a reference to each until unloadAllMeshes
     static void loadAllMeshes();
+    static void unloadAllMeshes();
 
 private:
-    void add(const QVector3D &v, const QVector3D &n, const QVector2D &uv);
+    static std::vector<Handle> m_loaded;
 
-    void quad3(GLfloat x1, GLfloat y1, GLfloat z1,
-               GLfloat x2, GLfloat y2, GLfloat z2,
-               GLfloat x3, GLfloat y3, GLfloat z3,
-               GLfloat x4, GLfloat y4, GLfloat z4);
+    Dequantization computeDequantization() const;
+    // uvs outside [0,1] do not survive the unorm16 packing
+    bool hasTiledUvs() const;
 
-    QVector<GLfloat> m_data;
+    QVector<StagingVertex> m_vertices;
+    QVector<GLuint> m_indices;
+    QByteArray m_data;
     int m_count;
+    int m_stride;
     GLenum m_primitive;
+    bool m_quantized;
+    float m_boundingRadius;
+    QMatrix4x4 m_dequantization;
+    std::array<VertexAttribute, 3> m_attributes;
 
     QOpenGLVertexArrayObject m_vao;
     QOpenGLBuffer m_vbo;
+    QOpenGLBuffer m_ibo;
     QOpenGLVertexArrayObject::Binder* m_vao_binder;
 };
 
+template<typename Vertex>
+void CMesh::initVboAndVao()
+{
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+
+    Dequantization dq;
+    if(Vertex::quantized)
+        dq = computeDequantization();
+
+    m_stride = int(sizeof(Vertex));
+    m_quantized = Vertex::quantized;
+    m_attributes = Vertex::attributes();
+    m_dequantization.setToIdentity();
+    m_dequantization.translate(dq.offset);
+    m_dequantization.scale(dq.scale);
+
+    m_data.resize(m_count * m_stride);
+    Vertex* out = reinterpret_cast<Vertex*>(m_data.data());
+    float radiusSquared = 0.0f;
+    for(int i = 0; i < m_count; i++)
+    {
+        const StagingVertex& v = m_vertices[i];
+        out[i] = Vertex::pack(v.position, v.normal, v.uv, dq);
+        radiusSquared = qMax(radiusSquared, v.position.lengthSquared());
+    }
+    m_boundingRadius = std::sqrt(radiusSquared);
+    m_vertices.clear();
+    m_vertices.squeeze();
+
+    m_vao.create(); // creates vertex array object
+    m_vao_binder = new QOpenGLVertexArrayObject::Binder(&m_vao); // binds vertex array object
+    m_vbo.create(); // creates vertex buffer object
+    m_vbo.bind(); // binds vertex buffer object
+    m_vbo.allocate(constData(), m_data.size()); // copies mesh data to vertex buffer object
+
+    for(const VertexAttribute& a : Vertex::attributes())
+    {
+        f->glEnableVertexAttribArray(a.location);
+        f->glVertexAttribPointer(a.location, a.size, a.type, a.normalized, m_stride, reinterpret_cast<void *>(a.offset));
+    }
+
+    // the element buffer binding is part of the vertex array object
+    if(isIndexed())
+    {
+        m_ibo.create();
+        m_ibo.bind();
+        m_ibo.allocate(m_indices.constData(), m_indices.size() * int(sizeof(GLuint)));
+    }
+}
+
 #endif // CMesh_H
 
@@ -0,0 +1,50 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <QtGlobal>
+
+// collision layers and the precomputed pair responses
+namespace Collision
+{
+    enum Layer : quint8
+    {
+        PlayerLayer,
+        WorldLayer,
+        BulletLayer,
+        LayerCount
+    };
+
+    enum Response : quint8
+    {
+        Ignore,
+        Bounce
+    };
+
+    // row: the object running the pair test, column: the object it overlaps;
+    // a player running into a bullet leaves it alone, the bullet still bounces off the player
+    constexpr Response ResponseTable[LayerCount][LayerCount] = {
+        //             Player  World   Bullet
+        /* Player */ { Bounce, Bounce, Ignore },
+        /* World  */ { Bounce, Bounce, Bounce },
+        /* Bullet */ { Bounce, Bounce, Bounce },
+    };
+
+    constexpr quint32 layerBit(quint8 layer)
+    {
+        return 1u << layer;
+    }
+
+    // one bit for every column of the row that responds
+    constexpr quint32 mask(quint8 layer, int column = 0)
+    {
+        return column == LayerCount ? 0u
+                : (ResponseTable[layer][column] != Ignore ? layerBit(quint8(column)) : 0u) | mask(layer, column + 1);
+    }
+
+    constexpr Response response(quint8 tester, quint8 other)
+    {
+        return ResponseTable[tester][other];
+    }
+}
+
+#endif // COLLISION_H
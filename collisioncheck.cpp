@@ -0,0 +1,142 @@
+#include "collisioncheck.h"
+#include "simulation.h"
+#include "player.h"
+#include "bullet.h"
+#include <iostream>
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+    struct World
+    {
+        Simulation simulation;
+        Player player;
+    };
+
+    // the pair loop as it was before collision layers, returns the player/bullet pairs it skipped
+    int legacyStep(Simulation& simulation)
+    {
+        std::vector<GameObject*>& objects = simulation.m_gameObjects;
+        int skipped = 0;
+        for(int i = 0; i < objects.size(); i++)
+        {
+            GameObject* obj = objects[i];
+
+            for(int j = 0; j < objects.size(); j++)
+            {
+                if(i == j) continue;
+
+                GameObject* obj2 = objects[j];
+
+                QVector3D v = obj->position - obj2->position;
+                float d = v.length();
+
+                if(d < (obj->m_radius + obj2->m_radius))
+                {
+                    std::string name1=obj->m_name;
+                    std::string name2=obj->m_name;
+                    GameObject* o1=obj;
+                    GameObject* o2=obj2;
+                    if(strcmp(name1.c_str(),name2.c_str())>0)
+                    {
+                        o1=obj2;
+                        o2=obj;
+                        v=-v;
+                    }
+                    if(!o1->m_name.compare("Player")&&!o2->m_name.compare("bullet"))
+                    {
+                        skipped++;
+                    }
+                    else
+                    {
+                        v.normalize();
+                        float energySum=obj->energy.length()+obj2->energy.length();
+                        obj->energy=v*energySum/2;
+                        obj2->energy=-v*energySum/2;
+                    }
+                }
+            }
+            obj->update();
+        }
+        for(int i=0; i<objects.size();)
+        {
+            GameObject* obj=objects[i];
+            if(obj->isAlive==false)
+            {
+                objects.erase(objects.begin()+i);
+                delete obj;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        simulation.m_tick++;
+        return skipped;
+    }
+
+    // walks through the cube grid while turning, fires and drops bullets on itself
+    void drive(World& world, int tick)
+    {
+        world.player.look(0.013f, 0.0f);
+        world.player.move(tick % 90 < 60 ? Player::Forward : Player::Back);
+        if(tick % 7 == 0)
+            world.simulation.spawnBullet(world.player);
+        if(tick % 13 == 0)
+        {
+            Bullet* bullet = world.simulation.spawnBullet(world.player);
+            bullet->position = world.player.position + world.player.direction * 0.3f;
+        }
+    }
+
+    bool same(const GameObject* a, const GameObject* b)
+    {
+        return a->m_id == b->m_id && a->isAlive == b->isAlive &&
+                memcmp(&a->position, &b->position, sizeof(QVector3D)) == 0 &&
+                memcmp(&a->energy, &b->energy, sizeof(QVector3D)) == 0;
+    }
+}
+
+int CollisionCheck::run(int ticks)
+{
+    World current;
+    World legacy;
+    for(World* world : { &current, &legacy })
+    {
+        world->simulation.addObject(&world->player);
+        world->simulation.populate();
+    }
+
+    int skipped = 0;
+    size_t largest = 0;
+    for(int tick = 0; tick < ticks; tick++)
+    {
+        current.simulation.step();
+        skipped += legacyStep(legacy.simulation);
+        drive(current, tick);
+        drive(legacy, tick);
+
+        const std::vector<GameObject*>& a = current.simulation.m_gameObjects;
+        const std::vector<GameObject*>& b = legacy.simulation.m_gameObjects;
+        bool match = a.size() == b.size();
+        for(size_t i = 0; match && i < a.size(); i++)
+            match = same(a[i], b[i]);
+        largest = std::max(largest, a.size());
+
+        if(!match)
+        {
+            cout << "collision check: worlds differ at tick " << tick << endl;
+            current.simulation.clear(&current.player);
+            legacy.simulation.clear(&legacy.player);
+            return 1;
+        }
+    }
+
+    cout << "collision check: " << ticks << " ticks, up to " << largest << " objects, "
+         << skipped << " player/bullet pairs skipped, identical" << endl;
+    current.simulation.clear(&current.player);
+    legacy.simulation.clear(&legacy.player);
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef COLLISIONCHECK_H
+#define COLLISIONCHECK_H
+
+// runs the same scripted world through Simulation::step and through the old name based
+// pair rules and fails on the first tick where the two differ
+namespace CollisionCheck
+{
+    int run(int ticks);
+}
+
+#endif // COLLISIONCHECK_H
@@ -1,16 +1,19 @@
 #include "cube.h"
+#include <math.h>
 
 Cube::Cube()
 {
     m_name = "cube";
+    setLayer(Collision::WorldLayer);
+    m_lodTiered = true;
 }
 
 void Cube::init()
 {
-    m_mesh=CMesh::m_meshes["cube"];
+    static const AssetName mesh("cube");
+    m_mesh=CMesh::find(mesh);
     //scale=QVector3D(1.0f,1.0f,1.0f);
     //m_radius=sqrt(3.0f*pow(1.0f/2,2));
-    m_name="Cube";
 }
 
 void Cube::render(GLWidget *glwidget)
@@ -23,3 +26,17 @@ void Cube::update()
     position = position + energy;
     energy = energy/1.2f;
 }
+
+void Cube::advance(int ticks)
+{
+    // closed form of ticks updates: the moves sum up as a geometric series
+    const float decay = 1.0f / 1.2f;
+    float remaining = pow(decay, ticks);
+    position = position + energy * ((1.0f - remaining) / (1.0f - decay));
+    energy = energy * remaining;
+}
+
+GameObject::Type Cube::type() const
+{
+    return CubeType;
+}
@@ -12,8 +12,8 @@ public:
     void init();
     void render(GLWidget* glwidget);
     void update();
-
-    CMesh* m_mesh;
+    void advance(int ticks);
+    Type type() const;
 };
 
 #endif // CUBE_H
@@ -0,0 +1,172 @@
+#include "dynamicresolution.h"
+#include "frameprofiler.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QVector2D>
+#include <math.h>
+
+using namespace std;
+
+constexpr float DynamicResolution::MinScale;
+constexpr float DynamicResolution::MaxScale;
+
+DynamicResolution::DynamicResolution()
+    : m_budget(1000.0f / 60.0f), m_scale(MaxScale), m_average(0), m_fixed(false),
+      m_cooldown(0), m_probe(0), m_fbo(nullptr), m_program(nullptr)
+{
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    delete m_fbo;
+    delete m_program;
+}
+
+void DynamicResolution::initGL()
+{
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceFile(QOpenGLShader::Vertex, "resources/upscale.vs");
+    m_program->addShaderFromSourceFile(QOpenGLShader::Fragment, "resources/upscale.fs");
+    m_program->bindAttributeLocation("corner", 0);
+    m_program->link();
+
+    m_uvScaleLoc = m_program->uniformLocation("uvScale");
+    m_uvMinLoc = m_program->uniformLocation("uvMin");
+    m_uvMaxLoc = m_program->uniformLocation("uvMax");
+    m_texelSizeLoc = m_program->uniformLocation("texelSize");
+    m_sharpnessLoc = m_program->uniformLocation("sharpness");
+
+    const GLfloat corners[] = { -1, -1,  1, -1,  -1, 1,  1, 1 };
+    m_vao.create();
+    m_vbo.create();
+    m_vbo.bind();
+    m_vbo.allocate(corners, sizeof(corners));
+    m_vbo.release();
+}
+
+void DynamicResolution::cleanupGL()
+{
+    delete m_fbo;
+    m_fbo = nullptr;
+    m_vbo.destroy();
+    m_vao.destroy();
+    delete m_program;
+    m_program = nullptr;
+}
+
+void DynamicResolution::resize(int width, int height)
+{
+    m_size = QSize(qMax(1, width), qMax(1, height));
+
+    delete m_fbo;
+    m_fbo = new QOpenGLFramebufferObject(m_size, QOpenGLFramebufferObject::Depth);
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glBindTexture(GL_TEXTURE_2D, m_fbo->texture());
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void DynamicResolution::setFixedScale(float scale)
+{
+    m_fixed = scale > 0;
+    if(m_fixed)
+        m_scale = qBound(0.1f, scale, MaxScale);
+}
+
+QSize DynamicResolution::renderSize() const
+{
+    return QSize(qMax(1, int(m_size.width() * m_scale + 0.5f)), qMax(1, int(m_size.height() * m_scale + 0.5f)));
+}
+
+void DynamicResolution::update(const FrameProfiler &profiler)
+{
+    if(m_fixed)
+        return;
+
+    // gpu time shows the headroom directly, without it the frame interval only tells when frames are late
+    bool gpu = profiler.hasGpuTimer();
+    float frame = gpu ? profiler.gpuTime() : profiler.frameInterval();
+    float target = gpu ? m_budget * 0.85f : m_budget;
+    m_average += (frame - m_average) * 0.1f;
+
+    if(m_probe > 0)
+        m_probe--;
+    // let the average settle after every change
+    if(m_cooldown > 0)
+    {
+        m_cooldown--;
+        return;
+    }
+
+    float next = m_scale;
+    if(m_average > target * 1.1f)
+    {
+        // the fill cost follows the area
+        next = m_scale * qMax(0.9f, float(sqrt(target / m_average)));
+        if(!gpu)
+            m_probe = 600;
+    }
+    else if(gpu ? m_average < target * 0.8f : m_probe == 0)
+    {
+        next = m_scale + 0.02f;
+    }
+
+    next = qBound(MinScale, next, MaxScale);
+    if(next != m_scale)
+    {
+        m_scale = next;
+        m_cooldown = 15;
+    }
+}
+
+void DynamicResolution::begin()
+{
+    if(m_fbo == nullptr)
+        return;
+
+    QSize size = renderSize();
+    m_fbo->bind();
+    QOpenGLContext::currentContext()->functions()->glViewport(0, 0, size.width(), size.height());
+}
+
+void DynamicResolution::end(GLuint target)
+{
+    if(m_fbo == nullptr || m_program == nullptr)
+        return;
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    f->glBindFramebuffer(GL_FRAMEBUFFER, target);
+    f->glViewport(0, 0, m_size.width(), m_size.height());
+    f->glDisable(GL_DEPTH_TEST);
+    f->glDisable(GL_CULL_FACE);
+
+    QSize size = renderSize();
+    QVector2D texel(1.0f / m_size.width(), 1.0f / m_size.height());
+    QVector2D used(float(size.width()) / m_size.width(), float(size.height()) / m_size.height());
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_uvScaleLoc, used);
+    m_program->setUniformValue(m_uvMinLoc, texel * 0.5f);
+    m_program->setUniformValue(m_uvMaxLoc, used - texel * 0.5f);
+    m_program->setUniformValue(m_texelSizeLoc, texel);
+    // sharpening makes up for the blur of the bilinear stretch, none at full resolution
+    m_program->setUniformValue(m_sharpnessLoc, 0.2f * (MaxScale - qMax(m_scale, MinScale)) / (MaxScale - MinScale));
+
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_2D, m_fbo->texture());
+
+    m_vbo.bind();
+    f->glEnableVertexAttribArray(0);
+    f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    f->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    f->glDisableVertexAttribArray(0);
+    m_vbo.release();
+
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    m_program->release();
+}
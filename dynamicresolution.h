@@ -0,0 +1,62 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <QSize>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+QT_FORWARD_DECLARE_CLASS(QOpenGLFramebufferObject)
+
+class FrameProfiler;
+
+// the scene is drawn into the lower left part of a full size offscreen target and
+// stretched over the widget; the part used shrinks when frames go over budget
+class DynamicResolution
+{
+public:
+    static constexpr float MinScale = 0.5f;
+    static constexpr float MaxScale = 1.0f;
+
+    DynamicResolution();
+    ~DynamicResolution();
+
+    void initGL();
+    void cleanupGL();
+    void resize(int width, int height);
+
+    // frame budget in milliseconds
+    void setBudget(float budget) { m_budget = budget; }
+    // a scale > 0 disables the automatic control
+    void setFixedScale(float scale);
+    bool isFixed() const { return m_fixed; }
+    float scale() const { return m_scale; }
+    QSize renderSize() const;
+
+    void update(const FrameProfiler& profiler);
+
+    void begin();
+    void end(GLuint target);
+
+private:
+    float m_budget;
+    float m_scale;
+    float m_average;
+    bool m_fixed;
+    int m_cooldown;
+    int m_probe;
+
+    QSize m_size;
+    QOpenGLFramebufferObject* m_fbo;
+    QOpenGLShaderProgram* m_program;
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vbo;
+    int m_uvScaleLoc;
+    int m_uvMinLoc;
+    int m_uvMaxLoc;
+    int m_texelSizeLoc;
+    int m_sharpnessLoc;
+};
+
+#endif // DYNAMICRESOLUTION_H
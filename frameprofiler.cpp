@@ -0,0 +1,125 @@
+#include "frameprofiler.h"
+#include <QOpenGLContext>
+#include <ctime>
+#include <cmath>
+#ifndef QT_OPENGL_ES_2
+#include <QOpenGLTimerQuery>
+#endif
+
+using namespace std;
+
+FrameProfiler::FrameProfiler()
+    : m_frameStart(-1), m_cpuTime(0), m_gpuTime(0), m_interval(0),
+      m_windowStart(0), m_windowClock(clock()), m_windowFrames(0), m_intervalSum(0), m_intervalSquares(0),
+      m_cpuUsage(0), m_jitter(0),
+      m_gpuTimer(false), m_query(0), m_active(false)
+{
+    for(int i = 0; i < QueryCount; i++)
+    {
+        m_queries[i] = nullptr;
+        m_pending[i] = false;
+    }
+    m_timer.start();
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    cleanupGL();
+}
+
+void FrameProfiler::initGL()
+{
+#ifndef QT_OPENGL_ES_2
+    if(QOpenGLContext::currentContext()->isOpenGLES())
+        return;
+
+    m_gpuTimer = true;
+    for(int i = 0; i < QueryCount; i++)
+    {
+        m_queries[i] = new QOpenGLTimerQuery();
+        if(!m_queries[i]->create())
+            m_gpuTimer = false;
+    }
+    if(!m_gpuTimer)
+        cleanupGL();
+#endif
+}
+
+void FrameProfiler::cleanupGL()
+{
+#ifndef QT_OPENGL_ES_2
+    for(int i = 0; i < QueryCount; i++)
+    {
+        delete m_queries[i];
+        m_queries[i] = nullptr;
+        m_pending[i] = false;
+    }
+#endif
+    m_gpuTimer = false;
+    m_active = false;
+}
+
+void FrameProfiler::beginFrame()
+{
+    qint64 now = m_timer.nsecsElapsed();
+    if(m_frameStart >= 0)
+    {
+        m_interval = (now - m_frameStart) * 1e-6f;
+        m_windowFrames++;
+        m_intervalSum += m_interval;
+        m_intervalSquares += double(m_interval) * m_interval;
+    }
+    m_frameStart = now;
+
+    // clock() is the processor time of every thread, the worker pools included
+    qint64 elapsed = now - m_windowStart;
+    if(elapsed >= StatsWindow * 1000000LL)
+    {
+        qint64 cpu = clock();
+        m_cpuUsage = float(double(cpu - m_windowClock) / CLOCKS_PER_SEC / (elapsed * 1e-9) * 100.0);
+        if(m_windowFrames > 0)
+        {
+            double mean = m_intervalSum / m_windowFrames;
+            m_jitter = float(sqrt(qMax(0.0, m_intervalSquares / m_windowFrames - mean * mean)));
+        }
+        m_windowStart = now;
+        m_windowClock = cpu;
+        m_windowFrames = 0;
+        m_intervalSum = 0;
+        m_intervalSquares = 0;
+    }
+
+#ifndef QT_OPENGL_ES_2
+    if(!m_gpuTimer)
+        return;
+
+    for(int i = 0; i < QueryCount; i++)
+    {
+        if(m_pending[i] && m_queries[i]->isResultAvailable())
+        {
+            m_gpuTime = m_queries[i]->waitForResult() * 1e-6f;
+            m_pending[i] = false;
+        }
+    }
+
+    // when every query is still in flight this frame goes unmeasured
+    m_active = !m_pending[m_query];
+    if(m_active)
+        m_queries[m_query]->begin();
+#endif
+}
+
+void FrameProfiler::endFrame()
+{
+    m_cpuTime = (m_timer.nsecsElapsed() - m_frameStart) * 1e-6f;
+
+#ifndef QT_OPENGL_ES_2
+    if(!m_active)
+        return;
+
+    m_queries[m_query]->end();
+    m_pending[m_query] = true;
+    m_query = (m_query + 1) % QueryCount;
+    m_active = false;
+#endif
+}
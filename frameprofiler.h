@@ -0,0 +1,60 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <QElapsedTimer>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLTimerQuery)
+
+// cpu time of the frame, interval between frames and, where timer queries exist,
+// gpu time; query results are read a few frames late so the pipeline never stalls;
+// process cpu usage and frame interval jitter are measured over StatsWindow
+class FrameProfiler
+{
+public:
+    static const int QueryCount = 4;
+    static const int StatsWindow = 1000;    // ms
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+    void initGL();
+    void cleanupGL();
+
+    void beginFrame();
+    void endFrame();
+
+    bool hasGpuTimer() const { return m_gpuTimer; }
+
+    // milliseconds, gpuTime is the latest resolved query
+    float cpuTime() const { return m_cpuTime; }
+    float gpuTime() const { return m_gpuTime; }
+    float frameInterval() const { return m_interval; }
+
+    // cpu time of the whole process in percent of one core, and the standard
+    // deviation of the frame interval in ms, both over the last full window
+    float cpuUsage() const { return m_cpuUsage; }
+    float jitter() const { return m_jitter; }
+
+private:
+    QElapsedTimer m_timer;
+    qint64 m_frameStart;
+    float m_cpuTime;
+    float m_gpuTime;
+    float m_interval;
+
+    qint64 m_windowStart;
+    qint64 m_windowClock;
+    int m_windowFrames;
+    double m_intervalSum;
+    double m_intervalSquares;
+    float m_cpuUsage;
+    float m_jitter;
+
+    bool m_gpuTimer;
+    QOpenGLTimerQuery* m_queries[QueryCount];
+    bool m_pending[QueryCount];
+    int m_query;
+    bool m_active;
+};
+
+#endif // FRAMEPROFILER_H
@@ -0,0 +1,100 @@
+#include "framescheduler.h"
+#include <QWidget>
+#include <QGuiApplication>
+#include <QScreen>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+    double refreshRate()
+    {
+        QScreen* screen = QGuiApplication::primaryScreen();
+        return screen != nullptr && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0;
+    }
+}
+
+FrameScheduler::FrameScheduler(QWidget *widget)
+    : m_widget(widget), m_dirty(0), m_continuous(false), m_idle(false), m_resumed(false),
+      m_vsync(true), m_period(1000000000LL / 60), m_nextFrame(0), m_probeFrames(0), m_probeStart(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&m_timer, &QTimer::timeout, [this]()
+    {
+        m_widget->update();
+    });
+    m_clock.start();
+}
+
+void FrameScheduler::markDirty(quint8 reasons)
+{
+    m_dirty |= reasons;
+    if(!m_idle)
+        return;
+
+    // draw right away instead of waiting out the idle period
+    m_idle = false;
+    m_resumed = true;
+    m_timer.stop();
+    m_widget->update();
+}
+
+void FrameScheduler::frameDone(quint8 reasons)
+{
+    bool active = m_continuous || (m_dirty | reasons) != 0;
+    m_dirty = 0;
+    qint64 now = m_clock.nsecsElapsed();
+
+    if(!active)
+    {
+        if(!m_idle)
+            m_probeFrames = 0;
+        m_idle = true;
+        m_resumed = false;
+        scheduleAt(now + 1000000000LL / IdleRate);
+        return;
+    }
+    m_resumed = false;
+    m_idle = false;
+
+    if(m_vsync)
+    {
+        // back to back frames faster than half the refresh rate mean the swap does not wait
+        if(m_probeFrames == 0)
+            m_probeStart = now;
+        if(++m_probeFrames == VsyncProbeFrames)
+        {
+            double interval = double(now - m_probeStart) / (VsyncProbeFrames - 1);
+            if(interval < 0.5e9 / refreshRate())
+            {
+                m_vsync = false;
+                cout << "Vsync - Not Supported!, pacing to " << 1000000000LL / m_period << " fps" << endl;
+            }
+        }
+        if(m_vsync)
+        {
+            m_widget->update();
+            return;
+        }
+    }
+
+    // deadlines advance by whole periods so the timer rounding does not add up,
+    // after a stall the schedule restarts from now
+    m_nextFrame += m_period;
+    if(m_nextFrame < now - m_period)
+        m_nextFrame = now;
+    scheduleAt(m_nextFrame);
+}
+
+float FrameScheduler::framePeriod() const
+{
+    return m_vsync ? float(1000.0 / refreshRate()) : float(m_period * 1e-6);
+}
+
+void FrameScheduler::scheduleAt(qint64 deadline)
+{
+    qint64 wait = deadline - m_clock.nsecsElapsed();
+    m_timer.start(int(qMax(qint64(0), (wait + 500000) / 1000000)));
+}
@@ -0,0 +1,65 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QTimer>
+#include <QElapsedTimer>
+
+QT_FORWARD_DECLARE_CLASS(QWidget)
+
+// decides when the next frame is drawn instead of repainting back to back forever:
+// while something moves frames follow each other behind vsync, or on a precise timer
+// at the target rate where the swap does not block; at rest they drop to IdleRate
+// until a dirty mark wakes the scheduler up again
+class FrameScheduler
+{
+public:
+    enum Reason : quint8
+    {
+        SimulationDirty = 1,
+        CameraDirty = 2,
+        InputDirty = 4
+    };
+
+    static const int IdleRate = 4;
+    static const int VsyncProbeFrames = 30;
+
+    explicit FrameScheduler(QWidget* widget);
+
+    // vsync is what the surface format asked for, it is dropped when the swap turns out not to wait
+    void setVsync(bool vsync) { m_vsync = vsync; }
+    void setTargetRate(int fps) { m_period = 1000000000LL / qMax(1, fps); }
+    // test modes that need every frame drawn
+    void setContinuous(bool continuous) { m_continuous = continuous; }
+
+    // from event handlers, wakes the scheduler up when it idles
+    void markDirty(quint8 reasons);
+    // at the end of a frame with what the frame found still changing
+    void frameDone(quint8 reasons);
+
+    bool isIdle() const { return m_idle; }
+    // the current frame is the first after an idle gap
+    bool resumed() const { return m_resumed; }
+    bool usesVsync() const { return m_vsync; }
+    // milliseconds between active frames: the refresh interval with vsync, else the target rate
+    float framePeriod() const;
+
+private:
+    void scheduleAt(qint64 deadline);
+
+    QWidget* m_widget;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+
+    quint8 m_dirty;
+    bool m_continuous;
+    bool m_idle;
+    bool m_resumed;
+    bool m_vsync;
+    qint64 m_period;
+    qint64 m_nextFrame;
+
+    int m_probeFrames;
+    qint64 m_probeStart;
+};
+
+#endif // FRAMESCHEDULER_H
@@ -0,0 +1,29 @@
+#include "frustum.h"
+
+Frustum::Frustum(const QMatrix4x4 &viewProjection)
+{
+    // left, right, bottom, top, near, far from the rows of the matrix
+    QVector4D w = viewProjection.row(3);
+    for(int i = 0; i < 3; i++)
+    {
+        QVector4D r = viewProjection.row(i);
+        m_planes[i * 2] = w + r;
+        m_planes[i * 2 + 1] = w - r;
+    }
+    for(QVector4D& plane : m_planes)
+    {
+        float length = plane.toVector3D().length();
+        if(length > 0.0f)
+            plane /= length;
+    }
+}
+
+bool Frustum::intersectsSphere(const QVector3D &center, float radius) const
+{
+    for(const QVector4D& plane : m_planes)
+    {
+        if(QVector3D::dotProduct(plane.toVector3D(), center) + plane.w() < -radius)
+            return false;
+    }
+    return true;
+}
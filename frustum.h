@@ -0,0 +1,22 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+
+// the six clip planes of a view projection, normalized so that a plane
+// distance is in world units and a bounding sphere can be tested exactly
+class Frustum
+{
+public:
+    Frustum() {}
+    explicit Frustum(const QMatrix4x4& viewProjection);
+
+    bool intersectsSphere(const QVector3D& center, float radius) const;
+
+private:
+    QVector4D m_planes[6];
+};
+
+#endif // FRUSTUM_H
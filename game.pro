@@ -6,7 +6,29 @@ HEADERS       = glwidget.h \
     player.h \
     gameobject.h \
     cube.h \
-    bullet.h
+    bullet.h \
+    input.h \
+    vertexformat.h \
+    particlesystem.h \
+    benchmark.h \
+    simulation.h \
+    netprotocol.h \
+    gameserver.h \
+    netclient.h \
+    savegame.h \
+    clusteredlighting.h \
+    frameprofiler.h \
+    dynamicresolution.h \
+    collision.h \
+    collisioncheck.h \
+    meshpool.h \
+    arena.h \
+    allocationcounter.h \
+    assetregistry.h \
+    framescheduler.h \
+    procedural.h \
+    frustum.h \
+    allocationcheck.h
 SOURCES       = glwidget.cpp \
                 main.cpp \
     texturemanager.cpp \
@@ -16,9 +38,29 @@ SOURCES       = glwidget.cpp \
     player.cpp \
     gameobject.cpp \
     cube.cpp \
-    bullet.cpp
+    bullet.cpp \
+    input.cpp \
+    particlesystem.cpp \
+    benchmark.cpp \
+    simulation.cpp \
+    netprotocol.cpp \
+    gameserver.cpp \
+    netclient.cpp \
+    savegame.cpp \
+    clusteredlighting.cpp \
+    frameprofiler.cpp \
+    dynamicresolution.cpp \
+    collisioncheck.cpp \
+    meshpool.cpp \
+    arena.cpp \
+    allocationcounter.cpp \
+    assetregistry.cpp \
+    framescheduler.cpp \
+    procedural.cpp \
+    frustum.cpp \
+    allocationcheck.cpp
 
-QT           += widgets
+QT           += widgets concurrent network
 
 # install
 target.path = ./qtglgame
@@ -29,4 +71,8 @@ OBJECTS_DIR = builds/objects
 
 DISTFILES += \
     builds/resources/shader.fs \
-    builds/resources/shader.vs
+    builds/resources/shader.vs \
+    builds/resources/particle.fs \
+    builds/resources/particle.vs \
+    builds/resources/upscale.fs \
+    builds/resources/upscale.vs
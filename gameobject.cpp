@@ -4,3 +4,26 @@ GameObject::GameObject()
 {
 
 }
+
+void GameObject::setLayer(Collision::Layer layer)
+{
+    m_layer = layer;
+    m_collisionMask = Collision::mask(layer);
+}
+
+void GameObject::advance(int ticks)
+{
+    for(int i = 0; i < ticks; i++)
+        update();
+}
+
+QMatrix4x4 GameObject::modelMatrix() const
+{
+    QMatrix4x4 m;
+    m.translate(position);
+    m.rotate(rotation.x(),1,0,0);
+    m.rotate(rotation.y(),0,1,0);
+    m.rotate(rotation.z(),0,0,1);
+    m.scale(scale);
+    return m;
+}
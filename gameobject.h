@@ -2,15 +2,29 @@
 #define GAMEOBJECT_H
 
 #include <QVector3D>
+#include <QMatrix4x4>
 #include <texturemanager.h>
 #include <QOpenGLTexture>
+#include "collision.h"
+#include "assetregistry.h"
 
 class GLWidget;
+class CMesh;
 
 class GameObject
 {
 public:
     GameObject();
+    virtual ~GameObject() {}
+
+    enum Type : unsigned char
+    {
+        PlayerType,
+        CubeType,
+        BulletType
+    };
+
+    quint32 m_id = 0;
 
     QVector3D position = QVector3D(0.0f,0.0f,0.0f);
     QVector3D rotation = QVector3D(0.0f,0.0f,0.0f);
@@ -19,15 +33,36 @@ public:
     QVector3D material_color = QVector3D(1.0f,1.0f,1.0f);
     std::string m_name;
 
+    // the layer this object is on and the layers it responds to when it runs the pair test
+    quint8 m_layer = Collision::WorldLayer;
+    quint32 m_collisionMask = Collision::mask(Collision::WorldLayer);
+    void setLayer(Collision::Layer layer);
+
+    // translation, x/y/z rotation and scale in the order the renderer applies them
+    QMatrix4x4 modelMatrix() const;
+
     virtual void init() = 0;
     virtual void render(GLWidget* glwidget) = 0;
     virtual void update() = 0;
+    // catches up several ticks at once, used by the simulation LOD for far objects
+    virtual void advance(int ticks);
+    virtual Type type() const = 0;
 
     QVector3D energy = QVector3D(0.0f,0.0f,0.0f);
 
     bool isAlive=true;
 
-    QOpenGLTexture* m_texture = nullptr;
+    // the tick after the last step, the simulation LOD advances by the difference
+    quint32 m_lodTick = 0;
+    // whether the simulation LOD may step it below full rate, set by types that can catch up
+    bool m_lodTiered = false;
+
+    // the save that already holds this object's state and which of its copies has it, see SaveGame::preserve
+    quint32 m_saveEpoch = 0;
+    quint32 m_saveRecord = 0;
+
+    qint16 m_material = TextureManager::NoMaterial;
+    AssetRef<CMesh> m_mesh;
 };
 
 #endif // GAMEOBJECT_H
@@ -0,0 +1,162 @@
+#include "gameserver.h"
+#include "player.h"
+#include <QNetworkDatagram>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+static quint64 clientKey(const QHostAddress &address, quint16 port)
+{
+    return (quint64(address.toIPv4Address()) << 16) | port;
+}
+
+GameServer::GameServer(QObject *parent)
+    : QObject(parent), m_nextTick(0), m_bytesSent(0)
+{
+    connect(&m_socket, &QUdpSocket::readyRead, this, &GameServer::readPendingDatagrams);
+    connect(&m_timer, &QTimer::timeout, this, &GameServer::tick);
+}
+
+GameServer::~GameServer()
+{
+    for(const Client& client : m_clients)
+    {
+        m_simulation.removeObject(client.player);
+        delete client.player;
+    }
+}
+
+bool GameServer::listen(quint16 port)
+{
+    if(!m_socket.bind(QHostAddress::LocalHost, port))
+    {
+        cout << "Server: cannot bind port " << port << endl;
+        return false;
+    }
+
+    m_simulation.populate();
+
+    m_clock.start();
+    m_nextTick = 0;
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.start(2);
+
+    cout << "Server: listening on port " << m_socket.localPort() << endl;
+    return true;
+}
+
+void GameServer::readPendingDatagrams()
+{
+    while(m_socket.hasPendingDatagrams())
+    {
+        QNetworkDatagram datagram = m_socket.receiveDatagram();
+        Net::PlayerInput input;
+        if(Net::decodeInput(datagram.data(), input))
+            handleInput(datagram.senderAddress(), quint16(datagram.senderPort()), input);
+    }
+}
+
+void GameServer::handleInput(const QHostAddress &address, quint16 port, const Net::PlayerInput &input)
+{
+    quint64 key = clientKey(address, port);
+    auto it = m_clients.find(key);
+    if(it == m_clients.end())
+    {
+        Client client;
+        client.address = address;
+        client.port = port;
+        client.player = new Player();
+        client.player->position = QVector3D((m_clients.size() % 16) * 0.5f - 4.0f, 0, 2.0f + (m_clients.size() / 16) * 0.5f);
+        client.lastInput = 0;
+        client.ackTick = 0;
+        client.buttons = 0;
+        client.fireCount = input.fireCount;
+        m_simulation.addObject(client.player);
+        it = m_clients.insert(key, client);
+    }
+
+    Client& client = it.value();
+    client.lastHeard = m_clock.elapsed();
+    client.ackTick = qMax(client.ackTick, input.ackTick);
+    if(input.sequence <= client.lastInput)
+        return;
+
+    client.lastInput = input.sequence;
+    client.buttons = input.buttons;
+    client.player->phi = input.phi;
+    client.player->theta = input.theta;
+    client.player->look(0, 0);
+
+    int shots = quint8(input.fireCount - client.fireCount);
+    client.fireCount = input.fireCount;
+    for(int i = 0; i < qMin(shots, 4); i++)
+        m_simulation.spawnBullet(*client.player);
+}
+
+void GameServer::dropIdleClients()
+{
+    qint64 now = m_clock.elapsed();
+    for(auto it = m_clients.begin(); it != m_clients.end();)
+    {
+        if(now - it->lastHeard > 5000)
+        {
+            m_simulation.removeObject(it->player);
+            delete it->player;
+            it = m_clients.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void GameServer::tick()
+{
+    const double tickMs = 1000.0 / Net::TickRate;
+    while(m_clock.elapsed() >= m_nextTick)
+    {
+        // the server has no view frustums, only distance to the players decides the LOD
+        m_simulation.clearLodViews();
+        for(const Client& client : m_clients)
+        {
+            client.player->move(client.buttons);
+            m_simulation.addLodView(client.player->position);
+        }
+        m_simulation.step();
+
+        if(m_simulation.m_tick % Net::SnapshotInterval == 0)
+        {
+            dropIdleClients();
+            sendSnapshots();
+        }
+        m_nextTick += tickMs;
+    }
+}
+
+void GameServer::sendSnapshots()
+{
+    Net::Snapshot& snapshot = m_history[m_simulation.m_tick % Net::HistorySize];
+    snapshot.tick = m_simulation.m_tick;
+    snapshot.entities.clear();
+    for(GameObject* obj : m_simulation.m_gameObjects)
+        snapshot.entities.push_back(Net::quantize(obj));
+    std::sort(snapshot.entities.begin(), snapshot.entities.end(),
+              [](const Net::EntityState& a, const Net::EntityState& b) { return a.id < b.id; });
+
+    for(const Client& client : m_clients)
+    {
+        const Net::Snapshot* baseline = nullptr;
+        const Net::Snapshot& acked = m_history[client.ackTick % Net::HistorySize];
+        if(client.ackTick != 0 && acked.tick == client.ackTick)
+            baseline = &acked;
+
+        snapshot.inputAck = client.lastInput;
+        snapshot.playerId = client.player->m_id;
+        QByteArray packet = Net::encodeSnapshot(snapshot, baseline);
+        qint64 written = m_socket.writeDatagram(packet, client.address, client.port);
+        if(written > 0)
+            m_bytesSent += written;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef GAMESERVER_H
+#define GAMESERVER_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include "simulation.h"
+#include "netprotocol.h"
+
+class Player;
+
+// headless authoritative server, runs Simulation::step at a fixed rate and
+// sends delta compressed snapshots to every client that sent input recently
+class GameServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    GameServer(QObject *parent = nullptr);
+    ~GameServer();
+
+    bool listen(quint16 port);
+    quint16 port() const { return m_socket.localPort(); }
+    int clientCount() const { return m_clients.size(); }
+    quint64 bytesSent() const { return m_bytesSent; }
+
+private slots:
+    void readPendingDatagrams();
+    void tick();
+
+private:
+    struct Client
+    {
+        QHostAddress address;
+        quint16 port;
+        Player* player;
+        quint32 lastInput;
+        quint32 ackTick;
+        quint8 buttons;
+        quint8 fireCount;
+        qint64 lastHeard;
+    };
+
+    void handleInput(const QHostAddress& address, quint16 port, const Net::PlayerInput& input);
+    void dropIdleClients();
+    void sendSnapshots();
+
+    Simulation m_simulation;
+    QUdpSocket m_socket;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    double m_nextTick;
+
+    QHash<quint64, Client> m_clients;
+    Net::Snapshot m_history[Net::HistorySize];
+    quint64 m_bytesSent;
+};
+
+#endif // GAMESERVER_H
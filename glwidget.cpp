@@ -4,22 +4,82 @@
 #include <QCoreApplication>
 #include <math.h>
 #include <iostream>
-#include <qstack.h>
+#include <QTimer>
+#include <QFile>
 #include "bullet.h"
 #include "cube.h"
 #include "texturemanager.h"
+#include "netclient.h"
+#include "savegame.h"
+#include "allocationcounter.h"
+#include "frustum.h"
 
 using namespace std;
 
+// the shader files are compiled with the feature defines prepended
+static bool addShader(QOpenGLShaderProgram* program, QOpenGLShader::ShaderType type, const char* path, const QByteArray& defines)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        cout << "Loading " << path << " - Not Found!" << endl;
+        return false;
+    }
+    return program->addShaderFromSourceCode(type, defines + file.readAll());
+}
+
 GLWidget::GLWidget(QWidget *parent)
     : QOpenGLWidget(parent),
-      m_program(nullptr)
+      m_program(nullptr),
+      m_scheduler(this)
 {
     setMouseTracking(true);
     QCursor c = cursor();
     c.setShape(Qt::CursorShape::BlankCursor);
     setCursor(c);
     setFocusPolicy(Qt::StrongFocus);
+
+    connect(this, &QOpenGLWidget::frameSwapped, this, &GLWidget::frameSwappedEvent);
+
+    // test mode: synthetic mouse deltas are injected between frames like real input
+    // and the time until the frame consuming them is swapped gets reported
+    m_latencyTest = QCoreApplication::arguments().contains("--latency-test");
+    if(m_latencyTest)
+    {
+        QTimer* probe = new QTimer(this);
+        connect(probe, &QTimer::timeout, this, &GLWidget::injectLatencyProbe);
+        probe->start(7);
+    }
+
+    m_lightStress = QCoreApplication::arguments().contains("--light-stress");
+    m_frameStats = QCoreApplication::arguments().contains("--frame-stats");
+    m_simulationLod = !QCoreApplication::arguments().contains("--no-sim-lod");
+    m_allocCheck = QCoreApplication::arguments().contains("--alloc-check");
+
+    QStringList args = QCoreApplication::arguments();
+
+    // --render-scale <s> pins the offscreen resolution, for benchmarking
+    int scaleArg = args.indexOf("--render-scale");
+    if(scaleArg >= 0 && scaleArg + 1 < args.size())
+        m_resolution.setFixedScale(args[scaleArg + 1].toFloat());
+
+    // client mode: --connect [port], the world comes from a server on loopback
+    int connectArg = args.indexOf("--connect");
+    if(connectArg >= 0)
+    {
+        quint16 port = Net::DefaultPort;
+        if(connectArg + 1 < args.size() && args[connectArg + 1].toUShort() != 0)
+            port = args[connectArg + 1].toUShort();
+        m_netClient = new NetClient(this);
+        m_netClient->connectToServer(QHostAddress::LocalHost, port);
+    }
+
+    // frames are drawn on demand, except for the modes that measure or stream every frame
+    m_scheduler.setVsync(!args.contains("--no-vsync"));
+    int fpsArg = args.indexOf("--fps");
+    if(fpsArg >= 0 && fpsArg + 1 < args.size())
+        m_scheduler.setTargetRate(args[fpsArg + 1].toInt());
+    m_scheduler.setContinuous(m_latencyTest || m_lightStress || m_allocCheck || m_netClient != nullptr);
 }
 
 GLWidget::~GLWidget()
@@ -34,8 +94,7 @@ QSize GLWidget::sizeHint() const
 
 void GLWidget::addObject(GameObject *obj)
 {
-    obj->init();
-    m_gameObjects.push_back(obj);
+    m_simulation.addObject(obj);
 }
 
 void GLWidget::cleanup()
@@ -44,6 +103,14 @@ void GLWidget::cleanup()
         return;
     makeCurrent();
 
+    m_particles.cleanupGL();
+    m_lighting.cleanupGL();
+    m_meshPool.cleanupGL();
+    m_resolution.cleanupGL();
+    m_profiler.cleanupGL();
+    CMesh::unloadAllMeshes();
+    CMesh::registry().collect();
+    TextureManager::cleanup();
     delete m_program;
     m_program = nullptr;
     doneCurrent();
@@ -59,11 +126,33 @@ void GLWidget::initializeGL()
     CMesh::loadAllMeshes();
 
     TextureManager::init();
+
+    // without float textures only the main light is used
+    if(!m_lighting.initGL())
+        cout << "Clustered lighting - Not Supported!" << endl;
+
+    // one multi draw per batch where supported, --no-multi-draw forces the per mesh path
+    QByteArray defines = m_lighting.shaderDefines() + TextureManager::shaderDefines();
+    if(!QCoreApplication::arguments().contains("--no-multi-draw") && m_meshPool.initGL(CMesh::registry()))
+        defines += "#define MULTI_DRAW\n";
+    else
+        cout << "Multi draw indirect - Not Supported!" << endl;
+
     m_program = new QOpenGLShaderProgram;
-    m_program->addShaderFromSourceFile(QOpenGLShader::Vertex, "resources/shader.vs");
-    m_program->addShaderFromSourceFile(QOpenGLShader::Fragment, "resources/shader.fs");
+    addShader(m_program, QOpenGLShader::Vertex, "resources/shader.vs", defines);
+    addShader(m_program, QOpenGLShader::Fragment, "resources/shader.fs", defines);
     m_program->bindAttributeLocation("vertex", 0);
     m_program->bindAttributeLocation("normal", 1);
+    m_program->bindAttributeLocation("uvCoord", 2);
+    if(m_meshPool.isActive())
+    {
+        m_program->bindAttributeLocation("drawModel0", MeshPool::DrawModelLocation);
+        m_program->bindAttributeLocation("drawModel1", MeshPool::DrawModelLocation + 1);
+        m_program->bindAttributeLocation("drawModel2", MeshPool::DrawModelLocation + 2);
+        m_program->bindAttributeLocation("drawModel3", MeshPool::DrawModelLocation + 3);
+        m_program->bindAttributeLocation("drawColor", MeshPool::DrawColorLocation);
+        m_program->bindAttributeLocation("drawMaterial", MeshPool::DrawMaterialLocation);
+    }
     m_program->link();
 
     m_program->bind();
@@ -72,59 +161,71 @@ void GLWidget::initializeGL()
     m_modelMatrixLoc = m_program->uniformLocation("modelMatrix");
     m_modelColorLoc = m_program->uniformLocation("modelColor");
     m_hasTextureLoc = m_program->uniformLocation("hasTexture");
+    m_materialLayerLoc = m_program->uniformLocation("materialLayer");
+    m_materialRectLoc = m_program->uniformLocation("materialRect");
     m_lightLoc.position = m_program->uniformLocation("light.position");
     m_lightLoc.ambient = m_program->uniformLocation("light.ambient");
     m_lightLoc.diffuse = m_program->uniformLocation("light.diffuse");
 
     m_program->release();
 
+    m_particles.initGL();
+    m_resolution.initGL();
+    m_profiler.initGL();
+
     lastUpdateTime = 0;
+    lastFrameTime = 0;
     timer.start();
     FPS=60;
 
+    m_simulation.m_particles = &m_particles;
     addObject((&m_player));
-    for(int i = 0; i < 5; i++)
-    {
-        for(int j = 0; j < 7; j++)
-        {
-            Cube* cube = new Cube();
-
-            cube->position.setX(j * 1 - 3);
-            cube->position.setY(0);
-            cube->position.setZ(i * 1 - 6);
-
-            cube->material_color.setX(i * 0.2f);
-            cube->material_color.setY(0.5f);
-            cube->material_color.setZ(j * 0.1f);
-
-            cube->scale = QVector3D(0.3f,0.3f,0.3f);
-
-            cube->m_radius = 0.5f * sqrt(3 * cube->scale.x() * cube->scale.x());
-            cube->m_texture = TextureManager::getTexture("brick");
+    if(m_netClient != nullptr)
+        m_netClient->attach(&m_simulation, &m_player);
+    else
+        m_simulation.populate();
 
-            addObject(cube);
-        }
-    }
+    // --load <file> restores a saved world instead of the default one
+    QStringList args = QCoreApplication::arguments();
+    int loadArg = args.indexOf("--load");
+    if(m_netClient == nullptr && loadArg >= 0 && loadArg + 1 < args.size())
+        SaveGame::load(args[loadArg + 1], m_simulation, m_player, cameraType);
 }
 
 void GLWidget::paintGL()
 {
+    quint64 frameAllocations = AllocationCounter::count();
+    m_profiler.beginFrame();
+    m_resolution.begin();
+
+    // meshes whose last reference went away are freed while the context is current
+    CMesh::registry().collect();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
 
-    QStack<QMatrix4x4> worldMatrixStack;
-
     m_program->bind();
 
     m_program->setUniformValue(m_lightLoc.position, QVector3D(0.0f, 0.0f, 15.0f));
     m_program->setUniformValue(m_lightLoc.ambient, QVector3D(0.1f, 0.1f, 0.1f));
     m_program->setUniformValue(m_lightLoc.diffuse, QVector3D(0.9f, 0.9f, 0.9f));
 
+    qint64 now = timer.nsecsElapsed();
+    float timerTime = now * 1e-9f;
+    float frameTime = timerTime - lastFrameTime;
+    lastFrameTime = timerTime;
+    // keys held through an idle gap should not turn the camera by the whole gap
+    if(m_scheduler.resumed())
+        frameTime = 1.0f / FPS;
+
     m_camera.setToIdentity();
 
     m_world.setToIdentity();
 
+    processInput(frameTime);
+    if(m_netClient != nullptr)
+        m_netClient->interpolate();
 
     if(cameraType == 'f')
     {
@@ -143,145 +244,268 @@ void GLWidget::paintGL()
             QVector3D(0,1,0));
     }
 
-    for(int i = 0; i < m_gameObjects.size(); i++)
+    quint8 changes = 0;
+    if(m_camera != m_lastCamera)
     {
-        GameObject* obj = m_gameObjects[i];
+        changes |= FrameScheduler::CameraDirty;
+        m_lastCamera = m_camera;
+    }
+
+    gatherLights(timerTime);
+    m_lighting.update(m_camera);
+    QSize renderSize = m_resolution.renderSize();
+    m_lighting.bind(m_program, renderSize.width(), renderSize.height());
+
+    bool pooled = m_meshPool.isActive();
+    if(pooled)
+    {
+        setTransforms();
+        m_meshPool.begin(m_frameArena, int(m_simulation.m_gameObjects.size()));
+    }
+
+    // only objects whose mesh bounds reach into the view are submitted
+    Frustum frustum(m_proj * m_camera);
+    m_visibleObjects = 0;
+
+    for(int i = 0; i < m_simulation.m_gameObjects.size(); i++)
+    {
+        GameObject* obj = m_simulation.m_gameObjects[i];
+        const CMesh* mesh = obj->m_mesh.get();
+        if(mesh == nullptr)
+            continue;
+        float scale = qMax(qAbs(obj->scale.x()), qMax(qAbs(obj->scale.y()), qAbs(obj->scale.z())));
+        if(!frustum.intersectsSphere(obj->position, mesh->boundingRadius() * scale))
+            continue;
+        m_visibleObjects++;
+
+        if(pooled)
+        {
+            QMatrix4x4 model = obj->modelMatrix();
+            if(m_meshPool.add(obj->m_mesh.handle(), model, obj->material_color, obj->m_material))
+                continue;
+            m_meshPool.setSingleDraw(mesh, model, obj->material_color, obj->m_material);
+            obj->render(this);
+            continue;
+        }
 
         m_program->setUniformValue(m_modelColorLoc, obj->material_color);
 
-        if(obj->m_texture!=nullptr)
+        if(obj->m_material!=TextureManager::NoMaterial)
         {
+            const TextureManager::Material& material = TextureManager::material(obj->m_material);
             m_program->setUniformValue(m_hasTextureLoc, 1);
-            obj->m_texture->bind();
+            m_program->setUniformValue(m_materialLayerLoc, material.layer);
+            m_program->setUniformValue(m_materialRectLoc, material.rect);
+            TextureManager::texture(obj->m_material)->bind();
         }
         else
         {
             m_program->setUniformValue(m_hasTextureLoc, 0);
         }
-        worldMatrixStack.push(m_world);
-            m_world.translate(obj->position);
-            m_world.rotate(obj->rotation.x(),1,0,0);
-            m_world.rotate(obj->rotation.y(),0,1,0);
-            m_world.rotate(obj->rotation.z(),0,0,1);
-            m_world.scale(obj->scale);
-            setTransforms();
-            obj->render(this);
-            m_world = worldMatrixStack.pop();
+        m_world = obj->modelMatrix();
+        setTransforms();
+        obj->render(this);
     }
+    m_world.setToIdentity();
+
+    if(pooled)
+        m_meshPool.draw();
 
     m_program->release();
 
-    float timerTime = timer.elapsed() * 0.001f;
-    float deltaTime = timerTime - lastUpdateTime;
-    if(deltaTime >= (1.0f/FPS))
+    m_particles.render(m_proj, m_camera, m_resolution.scale());
+
+    m_resolution.end(defaultFramebufferObject());
+
+    // one fixed step for every 1/FPS that passed, so the tick rate does not drift with how
+    // frames line up against it; a slow frame catches up on at most MaxCatchUpTicks, and
+    // idle frames and the first one after an idle gap run a single step instead of the gap
+    const qint64 step = qint64(1000000000.0 / FPS);
+    int backlog = m_scheduler.isIdle() || m_scheduler.resumed() ? 1 : MaxCatchUpTicks;
+    lastUpdateTime = qMax(lastUpdateTime, now - backlog * step);
+    while(now - lastUpdateTime >= step)
     {
         updateGL();
-        lastUpdateTime = timerTime;
+        lastUpdateTime += step;
     }
 
-    update();
-}
-
-void GLWidget::updateGL()
-{
-    for(int i = 0; i < m_gameObjects.size(); i++)
+    m_profiler.endFrame();
+    // idle frames and the first one after an idle gap are late on purpose, their interval
+    // says nothing about the load; the budget is whatever period the scheduler paces to
+    if(!m_scheduler.isIdle() && !m_scheduler.resumed())
     {
-        GameObject* obj = m_gameObjects[i];
+        m_resolution.setBudget(m_scheduler.framePeriod());
+        m_resolution.update(m_profiler);
+    }
+
+    m_frameArena.reset();
+    m_frameAllocations = AllocationCounter::count() - frameAllocations;
 
-        for(int j = 0; j < m_gameObjects.size(); j++)
+    if(m_allocCheck)
+    {
+        const int warmUp = 300;
+        const int checked = 600;
+        if(++m_allocFrames > warmUp && m_frameAllocations > 0)
+            m_allocDirtyFrames++;
+        if(m_allocFrames == warmUp + checked)
         {
-            if(i == j) continue;
-
-            GameObject* obj2 = m_gameObjects[j];
-
-            QVector3D v = obj->position - obj2->position;
-            float d = v.length();
-
-            if(d < (obj->m_radius + obj2->m_radius))
-            {
-                std::string name1=obj->m_name;
-                std::string name2=obj->m_name;
-                GameObject* o1=obj;
-                GameObject* o2=obj2;
-                if(strcmp(name1.c_str(),name2.c_str())>0)
-                {
-                    o1=obj2;
-                    o2=obj;
-                    v=-v;
-                }
-                if(!o1->m_name.compare("Player")&&!o2->m_name.compare("bullet"))
-                {
-
-                }
-                else
-                {
-                    v.normalize();
-                    float energySum=obj->energy.length()+obj2->energy.length();
-                    obj->energy=v*energySum/2;
-                    obj2->energy=-v*energySum/2;
-                }
-            }
+            cout << "alloc check: " << m_allocDirtyFrames << " of " << checked << " frames allocated" << endl;
+            QCoreApplication::exit(m_allocDirtyFrames > 0 ? 1 : 0);
         }
-        obj->update();
     }
-    QCursor::setPos(mapToGlobal(QPoint(width()/2,height()/2)));
-    if(m_keyState[Qt::Key_W])
+
+    if(m_lightStress)
     {
-        m_player.energy.setX(m_player.energy.x() + m_player.direction.x() * m_player.speed);
-        m_player.energy.setZ(m_player.energy.z() + m_player.direction.z() * m_player.speed);
+        m_stressCpuTime += m_profiler.cpuTime();
+        if(++m_stressFrames == 300)
+        {
+            cout << "lights " << m_lighting.lightCount() << ": " << m_stressCpuTime / 300 << " ms cpu per frame";
+            if(m_profiler.hasGpuTimer())
+                cout << ", " << m_profiler.gpuTime() << " ms gpu";
+            cout << endl;
+            m_stressLights = qMin(m_stressLights * 2, int(ClusteredLighting::MaxLights));
+            m_stressFrames = 0;
+            m_stressCpuTime = 0;
+        }
     }
-    if(m_keyState[Qt::Key_S])
+
+    if(m_frameStats)
     {
-        m_player.energy.setX(m_player.energy.x() - m_player.direction.x() * m_player.speed);
-        m_player.energy.setZ(m_player.energy.z() - m_player.direction.z() * m_player.speed);
+        m_statsInterval += m_profiler.frameInterval();
+        m_statsCpuTime += m_profiler.cpuTime();
+        m_statsAllocations += m_frameAllocations;
+        if(++m_statsFrames == 300 || m_statsInterval >= 5000.0f)
+        {
+            cout << "frame: " << m_statsInterval / m_statsFrames << " ms interval, " << m_profiler.jitter() << " ms jitter, "
+                 << m_statsCpuTime / m_statsFrames << " ms cpu, " << m_profiler.cpuUsage() << "% process cpu, "
+                 << float(m_statsAllocations) / m_statsFrames << " allocations";
+            if(m_profiler.hasGpuTimer())
+                cout << ", " << m_profiler.gpuTime() << " ms gpu";
+            cout << ", " << m_visibleObjects << " of " << m_simulation.m_gameObjects.size() << " objects visible";
+            cout << ", render scale " << m_resolution.scale();
+            cout << (m_scheduler.isIdle() ? ", idle" : m_scheduler.usesVsync() ? ", vsync" : ", timer paced") << endl;
+            m_statsFrames = 0;
+            m_statsInterval = 0;
+            m_statsCpuTime = 0;
+            m_statsAllocations = 0;
+        }
     }
-    if(m_keyState[Qt::Key_A])
+
+    if(!m_simulation.isAtRest() || m_saveGame.isBusy())
+        changes |= FrameScheduler::SimulationDirty;
+    if(m_particles.liveCount() > 0 || !m_particles.flashes().isEmpty())
+        changes |= FrameScheduler::SimulationDirty;
+    m_scheduler.frameDone(changes);
+}
+
+void GLWidget::updateGL()
+{
+    m_particles.update(1.0f/FPS);
+
+    quint8 buttons = 0;
+    if(m_input.isKeyDown(Qt::Key_W))
+        buttons |= Player::Forward;
+    if(m_input.isKeyDown(Qt::Key_S))
+        buttons |= Player::Back;
+    if(m_input.isKeyDown(Qt::Key_A))
+        buttons |= Player::Left;
+    if(m_input.isKeyDown(Qt::Key_D))
+        buttons |= Player::Right;
+
+    if(m_netClient != nullptr)
     {
-        m_player.energy.setX(m_player.energy.x() + m_player.direction.z() * m_player.speed);
-        m_player.energy.setZ(m_player.energy.z() - m_player.direction.x() * m_player.speed);
+        // the server is authoritative, only the local player is predicted
+        m_netClient->sendInput(buttons, m_pendingFire, m_player.phi, m_player.theta);
+        m_pendingFire = false;
+        m_player.move(buttons);
+        m_player.update();
+        return;
     }
-    if(m_keyState[Qt::Key_D])
+
+    m_simulation.clearLodViews();
+    if(m_simulationLod)
     {
-        m_player.energy.setX(m_player.energy.x() - m_player.direction.z() * m_player.speed);
-        m_player.energy.setZ(m_player.energy.z() + m_player.direction.x() * m_player.speed);
+        QMatrix4x4 viewProjection = m_proj * m_camera;
+        m_simulation.addLodView(m_player.position, &viewProjection);
     }
-    if(m_keyState[Qt::Key_Q])
+    m_simulation.step();
+    m_player.move(buttons);
+    m_saveGame.step();
+}
+
+void GLWidget::processInput(float frameTime)
+{
+    m_input.consume();
+    if(m_input.oldestEventTime() >= 0 && m_frameInputTime < 0)
+        m_frameInputTime = m_input.oldestEventTime();
+
+    float turn = 0;
+    if(m_input.isKeyDown(Qt::Key_Q))
+        turn -= 3.0f * frameTime;
+    if(m_input.isKeyDown(Qt::Key_E))
+        turn += 3.0f * frameTime;
+
+    m_player.look(m_input.mouseDx() * 0.01f + turn, m_input.mouseDy() * 0.01f);
+
+    if(m_input.isKeyDown(Qt::Key_F))
     {
-        float phi = atan2(m_player.direction.z(),m_player.direction.x());
-        phi = phi - 0.05f;
-        m_player.direction.setX(cos(phi));
-        m_player.direction.setZ(sin(phi));
+        cameraType = 'f';
     }
-    if(m_keyState[Qt::Key_E])
+    if(m_input.isKeyDown(Qt::Key_T))
     {
-        float phi = atan2(m_player.direction.z(),m_player.direction.x());
-        phi = phi + 0.05f;
-        m_player.direction.setX(cos(phi));
-        m_player.direction.setZ(sin(phi));
+        cameraType = 't';
     }
-    if(m_keyState[Qt::Key_F])
+
+    if((m_input.mouseDx() != 0 || m_input.mouseDy() != 0) && hasFocus())
     {
-        cameraType = 'f';
+        QPoint center(width()/2,height()/2);
+        QCursor::setPos(mapToGlobal(center));
+        m_input.resetMouseOrigin(center);
     }
-    if(m_keyState[Qt::Key_T])
+}
+
+void GLWidget::gatherLights(float time)
+{
+    m_lighting.clearLights();
+
+    for(GameObject* obj : m_simulation.m_gameObjects)
     {
-        cameraType = 't';
+        if(obj->type() == GameObject::BulletType)
+            m_lighting.addLight({ obj->position, 2.5f, QVector3D(1.0f, 0.6f, 0.2f) });
     }
-    for(int i=0; i<m_gameObjects.size();)
+
+    for(const ParticleSystem::Flash& flash : m_particles.flashes())
+        m_lighting.addLight({ flash.position, 3.0f, QVector3D(1.0f, 0.7f, 0.3f) * flash.life * 3.0f });
+
+    if(!m_lightStress)
+        return;
+
+    // lights orbiting over the cube grid
+    for(int i = 0; i < m_stressLights; i++)
     {
-        GameObject* obj=m_gameObjects[i];
-        if(obj->isAlive==false)
-        {
-            m_gameObjects.erase(m_gameObjects.begin()+i);
-            delete obj;
-        }
-        else
-        {
-            i++;
-        }
+        float angle = time * (0.3f + 0.05f * (i % 7)) + i * 2.39996f;
+        float distance = 0.5f + 4.0f * float(i % 32) / 32;
+        QVector3D position(sin(angle) * distance, 0.2f + 0.1f * (i % 8), -4.0f + cos(angle) * distance);
+        QVector3D color(0.5f + 0.5f * sin(i * 1.7f), 0.5f + 0.5f * sin(i * 2.3f + 2.0f), 0.5f + 0.5f * sin(i * 3.1f + 4.0f));
+        m_lighting.addLight({ position, 1.5f, color * 0.6f });
     }
 }
 
+void GLWidget::frameSwappedEvent()
+{
+    if(m_frameInputTime < 0)
+        return;
+
+    if(m_latencyTest)
+        m_latency.addSample(m_input.now() - m_frameInputTime);
+    m_frameInputTime = -1;
+}
+
+void GLWidget::injectLatencyProbe()
+{
+    m_input.pushMouseDelta(1, 0, m_input.now());
+}
+
 void GLWidget::setTransforms(void)
 {
     m_program->setUniformValue(m_projMatrixLoc, m_proj);
@@ -293,55 +517,48 @@ void GLWidget::resizeGL(int w, int h)
 {
     m_proj.setToIdentity();
     m_proj.perspective(60.0f, GLfloat(w) / h, 0.01f, 100.0f);
+    m_lighting.setProjection(60.0f, GLfloat(w) / h, 0.01f, 100.0f);
+    m_resolution.resize(int(w * devicePixelRatioF()), int(h * devicePixelRatioF()));
 }
 
 void GLWidget::mousePressEvent(QMouseEvent *event)
 {
     m_lastPos = event->pos();
+    m_scheduler.markDirty(FrameScheduler::InputDirty);
 }
 
 void GLWidget::mouseMoveEvent(QMouseEvent *event)
 {
-    float phi = atan2(m_player.direction.z(),m_player.direction.x());
-    float theta = acos(m_player.direction.y());
-
-    int dx = event->x() - width()/2;
-    int dy = event->y() - height()/2;
-
-    phi = phi + dx * 0.01f;
-    theta = theta + dy * 0.01f;
-    if(theta<0.01f)theta=0.01f;
-    if(theta>3.14f)theta=3.14f;
-
-    m_player.direction.setX(sin(theta) * cos(phi));
-    m_player.direction.setY(cos(theta));
-    m_player.direction.setZ(sin(theta)*sin(phi));
+    m_input.pushMouseMove(event->pos());
+    m_scheduler.markDirty(FrameScheduler::InputDirty);
 }
 
 void GLWidget::keyPressEvent(QKeyEvent *e)
 {
     if (e->key() == Qt::Key_Escape)
         exit(0);
+    else if(e->key()==Qt::Key_F5 && m_netClient == nullptr)
+        m_saveGame.begin("quicksave.sav", &m_simulation, m_player, cameraType);
+    else if(e->key()==Qt::Key_F9 && m_netClient == nullptr && !m_saveGame.isBusy())
+        SaveGame::load("quicksave.sav", m_simulation, m_player, cameraType);
     else if(e->key()==Qt::Key_Space)
     {
-        Bullet* bullet=new Bullet();
-        bullet->position=m_player.position+m_player.direction*0.7f;
-        bullet->position.setY(0);
-        bullet->scale=QVector3D(0.5f,0.5f,0.5f);
-        bullet->m_radius=0.5f;
-        bullet->energy=3*m_player.direction;
-        bullet->energy.setY(0);
-        addObject(bullet);
+        if(m_netClient != nullptr)
+            m_pendingFire = true;
+        else
+            m_simulation.spawnBullet(m_player);
     }
     else
         QWidget::keyPressEvent(e);
 
-    if(e->key() >= 0 && e->key() <= 255)
-        m_keyState[e->key()] = true;
+    if(!e->isAutoRepeat())
+        m_input.pushKey(e->key(), true);
+    m_scheduler.markDirty(FrameScheduler::InputDirty);
 }
 
 void GLWidget::keyReleaseEvent(QKeyEvent *e)
 {
-    if(e->key() >= 0 && e->key() <= 255)
-        m_keyState[e->key()] = false;
+    if(!e->isAutoRepeat())
+        m_input.pushKey(e->key(), false);
+    m_scheduler.markDirty(FrameScheduler::InputDirty);
 }
@@ -10,9 +10,21 @@
 #include <vector>
 #include "cmesh.h"
 #include "player.h"
+#include "input.h"
+#include "particlesystem.h"
+#include "simulation.h"
+#include "savegame.h"
+#include "clusteredlighting.h"
+#include "frameprofiler.h"
+#include "dynamicresolution.h"
+#include "meshpool.h"
+#include "arena.h"
+#include "framescheduler.h"
 
 QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
 
+class NetClient;
+
 class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
@@ -28,6 +40,8 @@ public:
 
 public slots:
     void cleanup();
+    void frameSwappedEvent();
+    void injectLatencyProbe();
 
 signals:
 
@@ -42,6 +56,8 @@ protected:
     void keyReleaseEvent(QKeyEvent *event) override;
 
     void setTransforms(void);
+    void processInput(float frameTime);
+    void gatherLights(float time);
 
 private:
 
@@ -59,6 +75,8 @@ private:
     int m_modelMatrixLoc;
     int m_modelColorLoc;
     int m_hasTextureLoc;
+    int m_materialLayerLoc;
+    int m_materialRectLoc;
     LightLocStruct m_lightLoc;
 
     QMatrix4x4 m_proj;
@@ -68,14 +86,63 @@ private:
 
     Player m_player;
 
-    std::vector<GameObject*> m_gameObjects;
+    Simulation m_simulation;
+    ParticleSystem m_particles;
+
+    ClusteredLighting m_lighting;
+    MeshPool m_meshPool;
+
+    // --light-stress: the light count doubles from 1 to MaxLights, frame cost is reported per step
+    bool m_lightStress = false;
+    int m_stressLights = 1;
+    int m_stressFrames = 0;
+    float m_stressCpuTime = 0;
+
+    FrameProfiler m_profiler;
+    DynamicResolution m_resolution;
+
+    // --frame-stats: averages printed every 300 frames, or every 5 s when frames are sparse
+    bool m_frameStats = false;
+    int m_statsFrames = 0;
+    float m_statsInterval = 0;
+    float m_statsCpuTime = 0;
+    quint64 m_statsAllocations = 0;
+
+    // transient per frame data: render queue and draw commands, released at the end of paintGL
+    Arena m_frameArena;
+    quint64 m_frameAllocations = 0;     // heap allocations of the last frame on the gui thread
+    int m_visibleObjects = 0;           // objects inside the view frustum in the last frame
 
-    bool m_keyState[256];
+    // --alloc-check: after a warm up the app exits with 1 if any frame touched the heap
+    bool m_allocCheck = false;
+    int m_allocFrames = 0;
+    int m_allocDirtyFrames = 0;
+
+    // repaints only while something changes, see FrameScheduler; --fps <n> sets the
+    // timer paced rate where vsync is unavailable or turned off with --no-vsync
+    FrameScheduler m_scheduler;
+    QMatrix4x4 m_lastCamera;
+
+    // --no-sim-lod steps every object at full rate
+    bool m_simulationLod = true;
+
+    SaveGame m_saveGame;
+
+    NetClient* m_netClient = nullptr;
+    bool m_pendingFire = false;
+
+    InputSystem m_input;
+    LatencyMeter m_latency;
+    qint64 m_frameInputTime = -1;
+    bool m_latencyTest = false;
 
     float m_camDistance = 1.5f;
 
+    static const int MaxCatchUpTicks = 5;
+
     QElapsedTimer timer;
-    float lastUpdateTime;
+    qint64 lastUpdateTime;  // nanoseconds on timer
+    float lastFrameTime;
     float FPS;
 };
 
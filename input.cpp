@@ -0,0 +1,184 @@
+#include "input.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+InputQueue::InputQueue()
+    : m_head(0), m_tail(0)
+{
+}
+
+bool InputQueue::push(const InputEvent &e, unsigned reserve)
+{
+    unsigned tail = m_tail.load(memory_order_relaxed);
+    unsigned next = (tail + 1) % Capacity;
+    unsigned used = (tail + Capacity - m_head.load(memory_order_acquire)) % Capacity;
+    if(used + 1 + reserve >= Capacity)
+        return false;
+
+    m_events[tail] = e;
+    m_tail.store(next, memory_order_release);
+    return true;
+}
+
+bool InputQueue::pop(InputEvent &e)
+{
+    unsigned head = m_head.load(memory_order_relaxed);
+    if(head == m_tail.load(memory_order_acquire))
+        return false;
+
+    e = m_events[head];
+    m_head.store((head + 1) % Capacity, memory_order_release);
+    return true;
+}
+
+InputSystem::InputSystem()
+{
+    std::fill(m_keyState, m_keyState + 256, false);
+    m_clock.start();
+}
+
+void InputSystem::pushMouseMove(const QPoint &pos)
+{
+    if(!m_hasMouseOrigin)
+    {
+        m_lastMousePos = pos;
+        m_hasMouseOrigin = true;
+        return;
+    }
+
+    QPoint d = pos - m_lastMousePos;
+    m_lastMousePos = pos;
+    if(d.x() != 0 || d.y() != 0)
+        pushMouseDelta(d.x(), d.y(), now());
+}
+
+void InputSystem::pushMouseDelta(int dx, int dy, qint64 timestamp)
+{
+    // deltas are summed into the pending one, it keeps the oldest timestamp
+    m_pendingDx += dx;
+    m_pendingDy += dy;
+    if(m_pendingTime < 0)
+        m_pendingTime = timestamp;
+    flushMouseDelta();
+}
+
+bool InputSystem::flushMouseDelta()
+{
+    if(m_pendingTime < 0)
+        return true;
+
+    InputEvent e;
+    e.type = InputEvent::MouseDelta;
+    e.key = 0;
+    e.dx = m_pendingDx;
+    e.dy = m_pendingDy;
+    e.timestamp = m_pendingTime;
+    if(!m_queue.push(e, InputQueue::KeyReserve))
+        return false;
+
+    m_pendingDx = 0;
+    m_pendingDy = 0;
+    m_pendingTime = -1;
+    return true;
+}
+
+void InputSystem::pushKey(int key, bool down)
+{
+    // keep the motion before the key in order when there is room for it
+    flushMouseDelta();
+
+    InputEvent e;
+    e.type = down ? InputEvent::KeyDown : InputEvent::KeyUp;
+    e.key = key;
+    e.dx = 0;
+    e.dy = 0;
+    e.timestamp = now();
+    if(!m_queue.push(e))
+        cout << "input queue full, dropped key " << key << endl;
+}
+
+void InputSystem::resetMouseOrigin(const QPoint &pos)
+{
+    m_lastMousePos = pos;
+    m_hasMouseOrigin = true;
+}
+
+void InputSystem::consume()
+{
+    m_mouseDx = 0;
+    m_mouseDy = 0;
+    m_oldestEvent = -1;
+
+    InputEvent e;
+    while(m_queue.pop(e))
+    {
+        if(m_oldestEvent < 0 || e.timestamp < m_oldestEvent)
+            m_oldestEvent = e.timestamp;
+
+        switch(e.type)
+        {
+        case InputEvent::MouseDelta:
+            m_mouseDx += e.dx;
+            m_mouseDy += e.dy;
+            break;
+        case InputEvent::KeyDown:
+        case InputEvent::KeyUp:
+            if(e.key >= 0 && e.key <= 255)
+                m_keyState[e.key] = (e.type == InputEvent::KeyDown);
+            break;
+        }
+    }
+
+    // producer and consumer both run on the gui thread, so motion that did
+    // not fit into the queue is taken over directly
+    if(m_pendingTime >= 0)
+    {
+        if(m_oldestEvent < 0 || m_pendingTime < m_oldestEvent)
+            m_oldestEvent = m_pendingTime;
+        m_mouseDx += m_pendingDx;
+        m_mouseDy += m_pendingDy;
+        m_pendingDx = 0;
+        m_pendingDy = 0;
+        m_pendingTime = -1;
+    }
+}
+
+bool InputSystem::isKeyDown(int key) const
+{
+    if(key < 0 || key > 255)
+        return false;
+    return m_keyState[key];
+}
+
+LatencyMeter::LatencyMeter(int reportEvery)
+    : m_reportEvery(reportEvery)
+{
+    m_samples.reserve(reportEvery);
+}
+
+void LatencyMeter::addSample(qint64 ns)
+{
+    m_samples.push_back(ns);
+    if(int(m_samples.size()) >= m_reportEvery)
+        report();
+}
+
+void LatencyMeter::report()
+{
+    std::sort(m_samples.begin(), m_samples.end());
+
+    qint64 sum = 0;
+    for(qint64 s : m_samples)
+        sum += s;
+
+    size_t n = m_samples.size();
+    cout << "input-to-photon latency [ms] over " << n << " samples:"
+         << " min " << m_samples.front() * 1e-6
+         << " avg " << (sum / double(n)) * 1e-6
+         << " p95 " << m_samples[n * 95 / 100] * 1e-6
+         << " max " << m_samples.back() * 1e-6 << endl;
+
+    m_samples.clear();
+}
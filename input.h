@@ -0,0 +1,102 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <QPoint>
+#include <QElapsedTimer>
+#include <atomic>
+#include <vector>
+
+struct InputEvent
+{
+    enum Type : unsigned char
+    {
+        MouseDelta,
+        KeyDown,
+        KeyUp
+    };
+
+    Type type;
+    int key;
+    int dx;
+    int dy;
+    qint64 timestamp;
+};
+
+// single producer / single consumer ring buffer, events are pushed from
+// the Qt event handlers and drained once per frame in paintGL
+class InputQueue
+{
+public:
+    InputQueue();
+
+    // fails when no more than reserve slots would be left free afterwards
+    bool push(const InputEvent& e, unsigned reserve = 0);
+    bool pop(InputEvent& e);
+
+    // slots mouse deltas leave free so key transitions are never dropped
+    static const unsigned KeyReserve = 64;
+
+private:
+    static const unsigned Capacity = 512;
+
+    InputEvent m_events[Capacity];
+    std::atomic<unsigned> m_head;
+    std::atomic<unsigned> m_tail;
+};
+
+class InputSystem
+{
+public:
+    InputSystem();
+
+    qint64 now() const { return m_clock.nsecsElapsed(); }
+
+    void pushMouseMove(const QPoint& pos);
+    void pushMouseDelta(int dx, int dy, qint64 timestamp);
+    void pushKey(int key, bool down);
+    void resetMouseOrigin(const QPoint& pos);
+
+    // drains the queue, accumulates the mouse delta and key transitions of this frame
+    void consume();
+
+    int mouseDx() const { return m_mouseDx; }
+    int mouseDy() const { return m_mouseDy; }
+    bool isKeyDown(int key) const;
+    qint64 oldestEventTime() const { return m_oldestEvent; }
+
+private:
+    bool flushMouseDelta();
+
+    InputQueue m_queue;
+    QElapsedTimer m_clock;
+
+    // mouse motion coalesced while the queue is near full
+    int m_pendingDx = 0;
+    int m_pendingDy = 0;
+    qint64 m_pendingTime = -1;
+
+    QPoint m_lastMousePos;
+    bool m_hasMouseOrigin = false;
+
+    int m_mouseDx = 0;
+    int m_mouseDy = 0;
+    qint64 m_oldestEvent = -1;
+    bool m_keyState[256];
+};
+
+// input-to-photon latency statistics, printed every m_reportEvery samples
+class LatencyMeter
+{
+public:
+    LatencyMeter(int reportEvery = 300);
+
+    void addSample(qint64 ns);
+
+private:
+    void report();
+
+    std::vector<qint64> m_samples;
+    int m_reportEvery;
+};
+
+#endif // INPUT_H
@@ -5,11 +5,77 @@
 
 #include "glwidget.h"
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "gameserver.h"
+#include "collisioncheck.h"
+#include "allocationcheck.h"
 
 using namespace std;
 
 int main(int argc, char *argv[])
 {
+    if(argc > 1 && QString(argv[1]) == "--particle-bench")
+    {
+        QCoreApplication app(argc, argv);
+        return Benchmark::particles();
+    }
+    if(argc > 1 && QString(argv[1]) == "--net-bench")
+    {
+        QCoreApplication app(argc, argv);
+        int clients = argc > 2 ? QString(argv[2]).toInt() : 200;
+        return Benchmark::network(clients > 0 ? clients : 200, 5);
+    }
+    if(argc > 1 && QString(argv[1]) == "--save-bench")
+    {
+        QCoreApplication app(argc, argv);
+        int objects = argc > 2 ? QString(argv[2]).toInt() : 1000000;
+        return Benchmark::saveLoad(objects > 0 ? objects : 1000000);
+    }
+    if(argc > 1 && QString(argv[1]) == "--benchmark")
+    {
+        // --benchmark [--out results.json] [--baseline previous.json] [--tolerance 0.1]
+        // the reference run is benchmarks/baseline.json next to the binary, compare with
+        // --benchmark --baseline benchmarks/baseline.json and after an intended change
+        // regenerate it on the same machine with --benchmark --out benchmarks/baseline.json
+        QCoreApplication app(argc, argv);
+        QStringList args = app.arguments();
+        auto option = [&args](const QString& name, const QString& fallback)
+        {
+            int i = args.indexOf(name);
+            return i >= 0 && i + 1 < args.size() ? args[i + 1] : fallback;
+        };
+        return Benchmark::suite(option("--out", QString()), option("--baseline", QString()),
+                                option("--tolerance", "0.1").toDouble());
+    }
+    if(argc > 1 && QString(argv[1]) == "--collision-check")
+    {
+        int ticks = argc > 2 ? QString(argv[2]).toInt() : 2000;
+        return CollisionCheck::run(ticks > 0 ? ticks : 2000);
+    }
+    if(argc > 1 && QString(argv[1]) == "--heap-check")
+        return AllocationCheck::run();
+    if(argc > 1 && QString(argv[1]) == "--server")
+    {
+        // headless authoritative server
+        QCoreApplication app(argc, argv);
+        GameServer server;
+        quint16 port = argc > 2 ? QString(argv[2]).toUShort() : Net::DefaultPort;
+        if(!server.listen(port))
+            return 1;
+        return app.exec();
+    }
+
+    // vsync paces the frames where the platform honors it, --no-vsync leaves
+    // the pacing to the frame scheduler's timer
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setSwapInterval(1);
+    for(int i = 1; i < argc; i++)
+    {
+        if(QString(argv[i]) == "--no-vsync")
+            format.setSwapInterval(0);
+    }
+    QSurfaceFormat::setDefaultFormat(format);
+
     QApplication app(argc, argv);
 
     QCoreApplication::setApplicationName("Qt GLGame");
@@ -0,0 +1,264 @@
+#include "meshpool.h"
+#include "cmesh.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLTexture>
+#include "texturemanager.h"
+#include "arena.h"
+#include <cstddef>
+#include <string.h>
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+using namespace std;
+
+MeshPool::MeshPool()
+    : m_active(false), m_multiDrawElementsIndirect(nullptr), m_drawCount(0),
+      m_arena(nullptr), m_entries(nullptr), m_capacity(0),
+      m_indices(QOpenGLBuffer::IndexBuffer), m_indirect(0)
+{
+}
+
+bool MeshPool::isSupported()
+{
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context->isOpenGLES())
+        return false;
+    if(context->format().version() >= qMakePair(4, 3))
+        return true;
+    return context->hasExtension("GL_ARB_multi_draw_indirect") &&
+            context->hasExtension("GL_ARB_draw_indirect") &&
+            context->hasExtension("GL_ARB_base_instance") &&
+            context->hasExtension("GL_ARB_instanced_arrays");
+}
+
+bool MeshPool::initGL(const AssetRegistry<CMesh> &meshes)
+{
+    if(!isSupported())
+        return false;
+
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    m_multiDrawElementsIndirect = reinterpret_cast<MultiDrawElementsIndirect>(context->getProcAddress("glMultiDrawElementsIndirect"));
+    if(m_multiDrawElementsIndirect == nullptr)
+        return false;
+
+    // the meshes share one vertex format, they only differ in where they start;
+    // a mesh in another format stays out and is drawn on its own
+    const CMesh* first = nullptr;
+    QByteArray data;
+    QVector<GLuint> indices;
+    meshes.forEach([&](AssetHandle<CMesh> handle, const CMesh* mesh)
+    {
+        if(mesh->vertexCount() == 0)
+            return;
+        if(first != nullptr && mesh->stride() != first->stride())
+            return;
+        if(first == nullptr)
+            first = mesh;
+
+        if(m_ranges.size() <= int(handle.index()))
+            m_ranges.resize(handle.index() + 1);
+        // indices stay relative to the mesh, baseVertex moves them to its vertices
+        GLuint firstIndex = GLuint(indices.size());
+        if(mesh->isIndexed())
+        {
+            for(int i = 0; i < mesh->indexCount(); i++)
+                indices.append(mesh->constIndexData()[i]);
+        }
+        else
+        {
+            for(int i = 0; i < mesh->vertexCount(); i++)
+                indices.append(GLuint(i));
+        }
+        Range range = { handle, firstIndex, GLuint(indices.size()) - firstIndex, GLint(data.size() / mesh->stride()) };
+        m_ranges[handle.index()] = range;
+        data.append(mesh->constData(), mesh->vertexCount() * mesh->stride());
+    });
+    if(first == nullptr)
+    {
+        m_ranges.clear();
+        return false;
+    }
+
+    QOpenGLFunctions *f = context->functions();
+    QOpenGLExtraFunctions *ef = context->extraFunctions();
+
+    m_vao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    m_vertices.create();
+    m_vertices.bind();
+    m_vertices.allocate(data.constData(), data.size());
+    for(const VertexAttribute& a : first->attributes())
+    {
+        f->glEnableVertexAttribArray(a.location);
+        f->glVertexAttribPointer(a.location, a.size, a.type, a.normalized, first->stride(), reinterpret_cast<void *>(a.offset));
+    }
+
+    m_indices.create();
+    m_indices.bind();
+    m_indices.allocate(indices.constData(), indices.size() * int(sizeof(GLuint)));
+
+    // one DrawData per instance, every command draws a single instance starting at its own baseInstance
+    m_draws.create();
+    m_draws.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    m_draws.bind();
+    for(GLuint c = 0; c < 4; c++)
+    {
+        GLuint location = DrawModelLocation + c;
+        f->glEnableVertexAttribArray(location);
+        f->glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData), reinterpret_cast<void *>(offsetof(DrawData, model) + c * 4 * sizeof(GLfloat)));
+        ef->glVertexAttribDivisor(location, 1);
+    }
+    f->glEnableVertexAttribArray(DrawColorLocation);
+    f->glVertexAttribPointer(DrawColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData), reinterpret_cast<void *>(offsetof(DrawData, color)));
+    ef->glVertexAttribDivisor(DrawColorLocation, 1);
+    f->glEnableVertexAttribArray(DrawMaterialLocation);
+    f->glVertexAttribPointer(DrawMaterialLocation, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData), reinterpret_cast<void *>(offsetof(DrawData, material)));
+    ef->glVertexAttribDivisor(DrawMaterialLocation, 1);
+
+    f->glGenBuffers(1, &m_indirect);
+
+    m_active = true;
+    return true;
+}
+
+void MeshPool::cleanupGL()
+{
+    if(!m_active)
+        return;
+
+    QOpenGLContext::currentContext()->functions()->glDeleteBuffers(1, &m_indirect);
+    m_indirect = 0;
+    m_draws.destroy();
+    m_vertices.destroy();
+    m_indices.destroy();
+    m_vao.destroy();
+    m_ranges.clear();
+    m_batches.clear();
+    m_active = false;
+}
+
+void MeshPool::begin(Arena &arena, int capacity)
+{
+    // the batch list stays from frame to frame, it only grows for a new texture
+    for(Batch& batch : m_batches)
+        batch.count = 0;
+    m_arena = &arena;
+    m_entries = arena.allocate<Entry>(size_t(capacity));
+    m_capacity = capacity;
+    m_drawCount = 0;
+}
+
+bool MeshPool::add(AssetHandle<CMesh> handle, const QMatrix4x4 &world, const QVector3D &color, qint16 material)
+{
+    // a mesh loaded after initGL, released since or in another format has no range
+    if(int(handle.index()) >= m_ranges.size() || m_ranges[handle.index()].mesh != handle || m_drawCount == m_capacity)
+        return false;
+    const Range* range = &m_ranges[handle.index()];
+    const CMesh* mesh = CMesh::registry().get(handle);
+    if(mesh == nullptr)
+        return false;
+
+    QOpenGLTexture* texture = TextureManager::texture(material);
+
+    int batch = 0;
+    while(batch < m_batches.size() && (m_batches[batch].primitive != mesh->primitive() || m_batches[batch].texture != texture))
+        batch++;
+    if(batch == m_batches.size())
+    {
+        Batch b = { mesh->primitive(), texture, 0, 0 };
+        m_batches.append(b);
+    }
+    m_batches[batch].count++;
+
+    Entry& entry = m_entries[m_drawCount++];
+    entry.batch = batch;
+    entry.command = { range->count, 1, range->firstIndex, range->baseVertex, 0 };
+    fillDrawData(entry.data, mesh, world, color, material);
+    return true;
+}
+
+void MeshPool::setSingleDraw(const CMesh *mesh, const QMatrix4x4 &world, const QVector3D &color, qint16 material)
+{
+    // attributes without an enabled array read the current value, the mesh VAO enables none of these
+    DrawData data;
+    fillDrawData(data, mesh, world, color, material);
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    for(GLuint c = 0; c < 4; c++)
+        f->glVertexAttrib4fv(DrawModelLocation + c, data.model + c * 4);
+    f->glVertexAttrib4fv(DrawColorLocation, data.color);
+    f->glVertexAttrib4fv(DrawMaterialLocation, data.material);
+
+    QOpenGLTexture* texture = TextureManager::texture(material);
+    if(texture != nullptr)
+        texture->bind();
+}
+
+void MeshPool::fillDrawData(DrawData &data, const CMesh *mesh, const QMatrix4x4 &world, const QVector3D &color, qint16 material)
+{
+    QMatrix4x4 model = world * mesh->dequantization();
+    memcpy(data.model, model.constData(), sizeof(data.model));
+    data.color[0] = color.x();
+    data.color[1] = color.y();
+    data.color[2] = color.z();
+    data.color[3] = 0.0f;
+    data.material[0] = data.material[1] = 0.0f;
+    data.material[2] = data.material[3] = 1.0f;
+    if(material != TextureManager::NoMaterial)
+    {
+        const TextureManager::Material& m = TextureManager::material(material);
+        data.color[3] = m.layer + 1.0f;
+        for(int i = 0; i < 4; i++)
+            data.material[i] = m.rect[i];
+    }
+}
+
+void MeshPool::draw()
+{
+    if(!m_active || m_drawCount == 0)
+        return;
+
+    // the draws are recorded in object order, sort them into their batches
+    int offset = 0;
+    for(Batch& batch : m_batches)
+    {
+        batch.offset = offset;
+        offset += batch.count;
+        batch.count = 0;
+    }
+    DrawCommand* commands = m_arena->allocate<DrawCommand>(size_t(m_drawCount));
+    DrawData* drawData = m_arena->allocate<DrawData>(size_t(m_drawCount));
+    for(int i = 0; i < m_drawCount; i++)
+    {
+        const Entry& entry = m_entries[i];
+        Batch& batch = m_batches[entry.batch];
+        int slot = batch.offset + batch.count++;
+        commands[slot] = entry.command;
+        commands[slot].baseInstance = GLuint(slot);
+        drawData[slot] = entry.data;
+    }
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    m_draws.bind();
+    m_draws.allocate(drawData, m_drawCount * int(sizeof(DrawData)));
+    f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirect);
+    f->glBufferData(GL_DRAW_INDIRECT_BUFFER, m_drawCount * sizeof(DrawCommand), commands, GL_STREAM_DRAW);
+
+    for(const Batch& batch : m_batches)
+    {
+        if(batch.count == 0)
+            continue;
+        if(batch.texture != nullptr)
+            batch.texture->bind();
+        m_multiDrawElementsIndirect(batch.primitive, GL_UNSIGNED_INT, reinterpret_cast<void *>(batch.offset * sizeof(DrawCommand)), batch.count, 0);
+    }
+
+    f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_draws.release();
+}
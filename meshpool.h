@@ -0,0 +1,115 @@
+#ifndef MESHPOOL_H
+#define MESHPOOL_H
+
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector>
+#include <qopengl.h>
+#include "assetregistry.h"
+
+class CMesh;
+class Arena;
+QT_FORWARD_DECLARE_CLASS(QOpenGLTexture)
+
+// all meshes suballocated from one vertex and one index buffer behind one VAO, meshes
+// without indices get a sequential range; the visible objects are gathered into indirect
+// commands and submitted with one multi draw per batch, the per draw model matrix and
+// color are instanced attributes picked by baseInstance; a mesh the pool does not hold
+// is drawn on its own with the same data as constant attributes
+class MeshPool
+{
+public:
+    // attribute locations of the per draw data, after vertex, normal and uvCoord
+    static const GLuint DrawModelLocation = 3;
+    static const GLuint DrawColorLocation = 7;
+    static const GLuint DrawMaterialLocation = 8;
+
+    MeshPool();
+
+    // GL 4.3, or the multi draw indirect, base instance and instanced arrays extensions
+    static bool isSupported();
+
+    bool initGL(const AssetRegistry<CMesh>& meshes);
+    void cleanupGL();
+    bool isActive() const { return m_active; }
+
+    // the frame's draws are recorded in arena, room for up to capacity of them
+    void begin(Arena& arena, int capacity);
+    // false when the mesh has no range in the pool or the frame is full
+    bool add(AssetHandle<CMesh> mesh, const QMatrix4x4& world, const QVector3D& color, qint16 material);
+    void draw();
+
+    // for a draw add refused: sets its per draw data and texture, the mesh then draws with its own VAO
+    void setSingleDraw(const CMesh* mesh, const QMatrix4x4& world, const QVector3D& color, qint16 material);
+
+    int drawCount() const { return m_drawCount; }
+    int batchCount() const { return m_batches.size(); }
+
+private:
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    struct DrawData
+    {
+        GLfloat model[16];
+        GLfloat color[4];       // rgb, material layer + 1 or 0 when untextured
+        GLfloat material[4];    // uv rect of the material in its layer
+    };
+
+    // draws sharing a primitive and a texture go into one multi draw, with a texture
+    // array every material shares the same texture
+    struct Batch
+    {
+        GLenum primitive;
+        QOpenGLTexture* texture;
+        int count;
+        int offset;     // first command of the batch in the indirect buffer
+    };
+
+    struct Entry
+    {
+        int batch;
+        DrawCommand command;
+        DrawData data;
+    };
+
+    // where a mesh starts in the shared buffer, indexed by handle index
+    struct Range
+    {
+        AssetHandle<CMesh> mesh;
+        GLuint firstIndex;
+        GLuint count;
+        GLint baseVertex;
+    };
+
+    static void fillDrawData(DrawData& data, const CMesh* mesh, const QMatrix4x4& world, const QVector3D& color, qint16 material);
+
+    typedef void (QOPENGLF_APIENTRYP MultiDrawElementsIndirect)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+    bool m_active;
+    MultiDrawElementsIndirect m_multiDrawElementsIndirect;
+
+    QVector<Range> m_ranges;
+    QVector<Batch> m_batches;
+    int m_drawCount;
+
+    Arena* m_arena;
+    Entry* m_entries;
+    int m_capacity;
+
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vertices;
+    QOpenGLBuffer m_indices;
+    QOpenGLBuffer m_draws;
+    GLuint m_indirect;
+};
+
+#endif // MESHPOOL_H
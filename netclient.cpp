@@ -0,0 +1,207 @@
+#include "netclient.h"
+#include "simulation.h"
+#include "player.h"
+#include "particlesystem.h"
+#include <QNetworkDatagram>
+#include <algorithm>
+
+using namespace std;
+
+static const Net::EntityState* findEntity(const Net::Snapshot &snapshot, quint32 id)
+{
+    auto it = std::lower_bound(snapshot.entities.begin(), snapshot.entities.end(), id,
+                               [](const Net::EntityState& e, quint32 id) { return e.id < id; });
+    if(it == snapshot.entities.end() || it->id != id)
+        return nullptr;
+    return &*it;
+}
+
+NetClient::NetClient(QObject *parent)
+    : QObject(parent), m_port(0), m_latestTick(0), m_latestTime(0), m_lastAck(0),
+      m_sequence(0), m_fireCount(0), m_simulation(nullptr), m_player(nullptr),
+      m_bytesReceived(0), m_snapshotsReceived(0)
+{
+    connect(&m_socket, &QUdpSocket::readyRead, this, &NetClient::readPendingDatagrams);
+    m_clock.start();
+}
+
+NetClient::~NetClient()
+{
+    for(auto& proxy : m_proxies)
+    {
+        if(m_simulation != nullptr)
+            m_simulation->removeObject(proxy.second);
+        delete proxy.second;
+    }
+}
+
+bool NetClient::connectToServer(const QHostAddress &address, quint16 port)
+{
+    m_server = address;
+    m_port = port;
+    return m_socket.bind(QHostAddress::LocalHost, 0);
+}
+
+void NetClient::attach(Simulation *simulation, Player *player)
+{
+    m_simulation = simulation;
+    m_player = player;
+}
+
+void NetClient::sendInput(quint8 buttons, bool fire, float phi, float theta)
+{
+    if(fire)
+        m_fireCount++;
+
+    Net::PlayerInput& input = m_inputs[++m_sequence % InputHistory];
+    input.sequence = m_sequence;
+    input.ackTick = m_latestTick;
+    input.buttons = buttons;
+    input.fireCount = m_fireCount;
+    input.phi = phi;
+    input.theta = theta;
+    m_inputSent[m_sequence % InputHistory] = m_clock.nsecsElapsed();
+
+    m_socket.writeDatagram(Net::encodeInput(input), m_server, m_port);
+}
+
+const Net::Snapshot* NetClient::findSnapshot(quint32 tick) const
+{
+    const Net::Snapshot& s = m_history[tick % Net::HistorySize];
+    return s.tick == tick ? &s : nullptr;
+}
+
+void NetClient::readPendingDatagrams()
+{
+    auto baseline = [this](quint32 tick) { return findSnapshot(tick); };
+
+    while(m_socket.hasPendingDatagrams())
+    {
+        QNetworkDatagram datagram = m_socket.receiveDatagram();
+        m_bytesReceived += datagram.data().size();
+
+        if(!Net::decodeSnapshot(datagram.data(), baseline, m_decoded))
+            continue;
+        if(m_decoded.tick <= m_latestTick)
+            continue;
+
+        m_snapshotsReceived++;
+        if(m_decoded.inputAck > m_lastAck && m_sequence - m_decoded.inputAck < quint32(InputHistory))
+            m_roundTrips.push_back(m_clock.nsecsElapsed() - m_inputSent[m_decoded.inputAck % InputHistory]);
+
+        m_latestTick = m_decoded.tick;
+        m_latestTime = m_clock.nsecsElapsed();
+        std::swap(m_history[m_decoded.tick % Net::HistorySize], m_decoded);
+
+        const Net::Snapshot& snapshot = m_history[m_latestTick % Net::HistorySize];
+        if(m_simulation != nullptr)
+        {
+            applySnapshot(snapshot);
+            reconcile(snapshot);
+        }
+        m_lastAck = qMax(m_lastAck, snapshot.inputAck);
+    }
+}
+
+void NetClient::applySnapshot(const Net::Snapshot &snapshot)
+{
+    // proxies that are gone on the server
+    for(auto it = m_proxies.begin(); it != m_proxies.end();)
+    {
+        if(findEntity(snapshot, it->first) == nullptr)
+        {
+            GameObject* obj = it->second;
+            if(m_simulation->m_particles != nullptr && obj->type() == GameObject::BulletType)
+                m_simulation->m_particles->emit(ParticleSystem::Impact, obj->position, QVector3D(0,0,0), 256);
+            m_simulation->removeObject(obj);
+            delete obj;
+            it = m_proxies.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    for(const Net::EntityState& e : snapshot.entities)
+    {
+        if(e.id == snapshot.playerId || m_proxies.count(e.id))
+            continue;
+
+        GameObject* obj = m_simulation->createObject(GameObject::Type(e.type));
+        if(obj == nullptr)
+            continue;
+        m_simulation->addObject(obj);
+        Net::dequantize(e, obj);
+        m_proxies[e.id] = obj;
+    }
+}
+
+void NetClient::reconcile(const Net::Snapshot &snapshot)
+{
+    const Net::EntityState* own = findEntity(snapshot, snapshot.playerId);
+    if(own == nullptr || m_player == nullptr)
+        return;
+
+    // server state for the acknowledged input, then replay everything sent since
+    m_player->position = Net::position(*own);
+    m_player->energy = QVector3D(own->energy[0], own->energy[1], own->energy[2]) / 4096.0f;
+
+    quint32 first = snapshot.inputAck + 1;
+    if(m_sequence - snapshot.inputAck >= quint32(InputHistory))
+        first = m_sequence + 1;
+    for(quint32 seq = first; seq <= m_sequence; seq++)
+    {
+        m_player->move(m_inputs[seq % InputHistory].buttons);
+        m_player->update();
+    }
+}
+
+void NetClient::interpolate()
+{
+    if(m_simulation == nullptr || m_latestTick == 0)
+        return;
+
+    const double tickNs = 1e9 / Net::TickRate;
+    double renderTick = m_latestTick + (m_clock.nsecsElapsed() - m_latestTime) / tickNs - InterpolationDelay;
+
+    // newest snapshot at or before render time and the one after it
+    const Net::Snapshot* from = nullptr;
+    const Net::Snapshot* to = nullptr;
+    for(quint32 back = 0; back < quint32(Net::HistorySize) && back < m_latestTick; back++)
+    {
+        const Net::Snapshot* s = findSnapshot(m_latestTick - back);
+        if(s == nullptr)
+            continue;
+        if(s->tick <= renderTick)
+        {
+            from = s;
+            break;
+        }
+        to = s;
+    }
+    if(from == nullptr && to == nullptr)
+        return;
+    if(from == nullptr)
+        from = to;
+    if(to == nullptr)
+        to = from;
+
+    float t = 0.0f;
+    if(to->tick != from->tick)
+        t = qBound(0.0f, float((renderTick - from->tick) / (to->tick - from->tick)), 1.0f);
+
+    for(auto& proxy : m_proxies)
+    {
+        const Net::EntityState* b = findEntity(*to, proxy.first);
+        const Net::EntityState* a = findEntity(*from, proxy.first);
+        if(b == nullptr)
+            b = a;
+        if(b == nullptr)
+            continue;
+
+        Net::dequantize(*b, proxy.second);
+        if(a != nullptr)
+            proxy.second->position = Net::position(*a) * (1.0f - t) + Net::position(*b) * t;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef NETCLIENT_H
+#define NETCLIENT_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QElapsedTimer>
+#include <map>
+#include <vector>
+#include "netprotocol.h"
+
+class Simulation;
+class Player;
+
+// sends input every tick, decodes snapshots, predicts the local player and
+// interpolates every other entity between the two snapshots around render time
+class NetClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    NetClient(QObject *parent = nullptr);
+    ~NetClient();
+
+    bool connectToServer(const QHostAddress& address, quint16 port);
+
+    // without an attached world the client only decodes and acknowledges (benchmark)
+    void attach(Simulation* simulation, Player* player);
+
+    void sendInput(quint8 buttons, bool fire, float phi, float theta);
+    void interpolate();
+
+    quint64 bytesReceived() const { return m_bytesReceived; }
+    quint32 snapshotsReceived() const { return m_snapshotsReceived; }
+    const std::vector<qint64>& roundTrips() const { return m_roundTrips; }
+
+    static const int InterpolationDelay = 6;   // ticks
+
+private slots:
+    void readPendingDatagrams();
+
+private:
+    static const int InputHistory = 128;
+
+    const Net::Snapshot* findSnapshot(quint32 tick) const;
+    void applySnapshot(const Net::Snapshot& snapshot);
+    void reconcile(const Net::Snapshot& snapshot);
+
+    QUdpSocket m_socket;
+    QHostAddress m_server;
+    quint16 m_port;
+    QElapsedTimer m_clock;
+
+    Net::Snapshot m_history[Net::HistorySize];
+    Net::Snapshot m_decoded;
+    quint32 m_latestTick;
+    qint64 m_latestTime;
+    quint32 m_lastAck;
+
+    Net::PlayerInput m_inputs[InputHistory];
+    qint64 m_inputSent[InputHistory];
+    quint32 m_sequence;
+    quint8 m_fireCount;
+
+    Simulation* m_simulation;
+    Player* m_player;
+    std::map<quint32, GameObject*> m_proxies;
+
+    quint64 m_bytesReceived;
+    quint32 m_snapshotsReceived;
+    std::vector<qint64> m_roundTrips;
+};
+
+#endif // NETCLIENT_H
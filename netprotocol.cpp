@@ -0,0 +1,358 @@
+#include "netprotocol.h"
+#include <string.h>
+#include <math.h>
+
+using namespace std;
+
+namespace
+{
+    enum FieldMask : quint8
+    {
+        MaskType = 1,       // type, alive, color and material
+        MaskPosition = 2,
+        MaskEnergy = 4,
+        MaskScale = 8
+    };
+
+    class Writer
+    {
+    public:
+        Writer(QByteArray& out) : m_out(out) {}
+
+        void u8(quint8 v) { m_out.append(char(v)); }
+
+        void u32(quint32 v)
+        {
+            for(int i = 0; i < 4; i++)
+                u8(quint8(v >> (8 * i)));
+        }
+
+        void f32(float v)
+        {
+            quint32 bits;
+            memcpy(&bits, &v, sizeof(bits));
+            u32(bits);
+        }
+
+        void varint(quint32 v)
+        {
+            while(v >= 0x80)
+            {
+                u8(quint8(v | 0x80));
+                v >>= 7;
+            }
+            u8(quint8(v));
+        }
+
+        void zigzag(qint32 v)
+        {
+            varint((quint32(v) << 1) ^ quint32(v >> 31));
+        }
+
+    private:
+        QByteArray& m_out;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(const QByteArray& in) : m_in(in), m_pos(0), m_ok(true) {}
+
+        bool ok() const { return m_ok; }
+
+        quint8 u8()
+        {
+            if(m_pos >= m_in.size())
+            {
+                m_ok = false;
+                return 0;
+            }
+            return quint8(m_in[m_pos++]);
+        }
+
+        quint32 u32()
+        {
+            quint32 v = 0;
+            for(int i = 0; i < 4; i++)
+                v |= quint32(u8()) << (8 * i);
+            return v;
+        }
+
+        float f32()
+        {
+            quint32 bits = u32();
+            float v;
+            memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+
+        quint32 varint()
+        {
+            quint32 v = 0;
+            for(int shift = 0; shift < 35 && m_ok; shift += 7)
+            {
+                quint8 b = u8();
+                v |= quint32(b & 0x7F) << shift;
+                if((b & 0x80) == 0)
+                    break;
+            }
+            return v;
+        }
+
+        qint32 zigzag()
+        {
+            quint32 v = varint();
+            return qint32(v >> 1) ^ -qint32(v & 1);
+        }
+
+    private:
+        const QByteArray& m_in;
+        int m_pos;
+        bool m_ok;
+    };
+
+    qint16 quantizeFixed(float v, float unitsPerOne)
+    {
+        float q = roundf(v * unitsPerOne);
+        return qint16(qBound(-32767.0f, q, 32767.0f));
+    }
+
+    quint8 changedFields(const Net::EntityState& a, const Net::EntityState* b)
+    {
+        if(b == nullptr)
+            return MaskType | MaskPosition | MaskEnergy | MaskScale;
+
+        quint8 mask = 0;
+        if(a.type != b->type || a.alive != b->alive || memcmp(a.color, b->color, sizeof(a.color)) != 0 || a.material != b->material)
+            mask |= MaskType;
+        if(memcmp(a.position, b->position, sizeof(a.position)) != 0)
+            mask |= MaskPosition;
+        if(memcmp(a.energy, b->energy, sizeof(a.energy)) != 0)
+            mask |= MaskEnergy;
+        if(a.scale != b->scale)
+            mask |= MaskScale;
+        return mask;
+    }
+}
+
+Net::EntityState Net::quantize(const GameObject *obj)
+{
+    EntityState s;
+    s.id = obj->m_id;
+    s.type = obj->type();
+    s.alive = obj->isAlive ? 1 : 0;
+    s.color[0] = quint8(qBound(0.0f, obj->material_color.x(), 1.0f) * 255.0f);
+    s.color[1] = quint8(qBound(0.0f, obj->material_color.y(), 1.0f) * 255.0f);
+    s.color[2] = quint8(qBound(0.0f, obj->material_color.z(), 1.0f) * 255.0f);
+    s.material = obj->m_material == TextureManager::NoMaterial ? 0xFF : quint8(obj->m_material);
+    for(int i = 0; i < 3; i++)
+    {
+        s.position[i] = quantizeFixed(obj->position[i], 256.0f);
+        s.energy[i] = quantizeFixed(obj->energy[i], 4096.0f);
+    }
+    s.scale = quint16(qBound(0.0f, roundf(obj->scale.x() * 1024.0f), 65535.0f));
+    return s;
+}
+
+QVector3D Net::position(const EntityState &state)
+{
+    return QVector3D(state.position[0], state.position[1], state.position[2]) / 256.0f;
+}
+
+void Net::dequantize(const EntityState &state, GameObject *obj)
+{
+    obj->isAlive = state.alive != 0;
+    obj->material_color = QVector3D(state.color[0], state.color[1], state.color[2]) / 255.0f;
+    // indices from the wire are only trusted when this build has the material
+    bool known = state.material != 0xFF && state.material < TextureManager::m_materials.size();
+    obj->m_material = known ? qint16(state.material) : TextureManager::NoMaterial;
+    obj->position = position(state);
+    obj->energy = QVector3D(state.energy[0], state.energy[1], state.energy[2]) / 4096.0f;
+    float scale = state.scale / 1024.0f;
+    obj->scale = QVector3D(scale, scale, scale);
+}
+
+QByteArray Net::encodeInput(const PlayerInput &input)
+{
+    QByteArray packet;
+    Writer w(packet);
+    w.u8(InputPacket);
+    w.u32(input.sequence);
+    w.u32(input.ackTick);
+    w.u8(input.buttons);
+    w.u8(input.fireCount);
+    w.f32(input.phi);
+    w.f32(input.theta);
+    return packet;
+}
+
+bool Net::decodeInput(const QByteArray &packet, PlayerInput &input)
+{
+    Reader r(packet);
+    if(r.u8() != InputPacket)
+        return false;
+    input.sequence = r.u32();
+    input.ackTick = r.u32();
+    input.buttons = r.u8();
+    input.fireCount = r.u8();
+    input.phi = r.f32();
+    input.theta = r.f32();
+    return r.ok();
+}
+
+QByteArray Net::encodeSnapshot(const Snapshot &current, const Snapshot *baseline)
+{
+    static const std::vector<EntityState> empty;
+    const std::vector<EntityState>& base = baseline ? baseline->entities : empty;
+
+    QByteArray packet;
+    Writer w(packet);
+    w.u8(SnapshotPacket);
+    w.u32(current.tick);
+    w.u32(baseline ? baseline->tick : 0);
+    w.u32(current.inputAck);
+    w.u32(current.playerId);
+
+    // ids present in the baseline but gone now
+    std::vector<quint32> removed;
+    size_t c = 0;
+    for(const EntityState& b : base)
+    {
+        while(c < current.entities.size() && current.entities[c].id < b.id)
+            c++;
+        if(c == current.entities.size() || current.entities[c].id != b.id)
+            removed.push_back(b.id);
+    }
+    w.varint(quint32(removed.size()));
+    quint32 lastId = 0;
+    for(quint32 id : removed)
+    {
+        w.varint(id - lastId);
+        lastId = id;
+    }
+
+    // changed or new entities, values are deltas against the baseline
+    QByteArray records;
+    Writer rw(records);
+    quint32 changed = 0;
+    size_t bi = 0;
+    lastId = 0;
+    for(const EntityState& e : current.entities)
+    {
+        while(bi < base.size() && base[bi].id < e.id)
+            bi++;
+        const EntityState* b = (bi < base.size() && base[bi].id == e.id) ? &base[bi] : nullptr;
+
+        quint8 mask = changedFields(e, b);
+        if(mask == 0)
+            continue;
+
+        rw.varint(e.id - lastId);
+        lastId = e.id;
+        rw.u8(mask);
+        if(mask & MaskType)
+        {
+            rw.u8(e.type);
+            rw.u8(e.alive);
+            for(int i = 0; i < 3; i++)
+                rw.u8(e.color[i]);
+            rw.u8(e.material);
+        }
+        if(mask & MaskPosition)
+            for(int i = 0; i < 3; i++)
+                rw.zigzag(e.position[i] - (b ? b->position[i] : 0));
+        if(mask & MaskEnergy)
+            for(int i = 0; i < 3; i++)
+                rw.zigzag(e.energy[i] - (b ? b->energy[i] : 0));
+        if(mask & MaskScale)
+            rw.zigzag(e.scale - (b ? b->scale : 0));
+        changed++;
+    }
+    w.varint(changed);
+    packet.append(records);
+    return packet;
+}
+
+bool Net::decodeSnapshot(const QByteArray &packet, const std::function<const Snapshot *(quint32)> &findBaseline, Snapshot &out)
+{
+    Reader r(packet);
+    if(r.u8() != SnapshotPacket)
+        return false;
+
+    out.tick = r.u32();
+    quint32 baselineTick = r.u32();
+    out.inputAck = r.u32();
+    out.playerId = r.u32();
+    out.entities.clear();
+
+    const Snapshot* baseline = nullptr;
+    if(baselineTick != 0)
+    {
+        baseline = findBaseline(baselineTick);
+        if(baseline == nullptr)
+            return false;
+    }
+    static const std::vector<EntityState> empty;
+    const std::vector<EntityState>& base = baseline ? baseline->entities : empty;
+
+    quint32 removedCount = r.varint();
+    if(removedCount > quint32(packet.size()))
+        return false;
+    std::vector<quint32> removed(removedCount);
+    quint32 id = 0;
+    for(quint32& rid : removed)
+    {
+        id += r.varint();
+        rid = id;
+    }
+
+    size_t bi = 0;
+    size_t ri = 0;
+    auto copyBaseUntil = [&](quint64 limit)
+    {
+        for(; bi < base.size() && base[bi].id < limit; bi++)
+        {
+            while(ri < removed.size() && removed[ri] < base[bi].id)
+                ri++;
+            if(ri < removed.size() && removed[ri] == base[bi].id)
+                continue;
+            out.entities.push_back(base[bi]);
+        }
+    };
+
+    quint32 changed = r.varint();
+    id = 0;
+    for(quint32 n = 0; n < changed && r.ok(); n++)
+    {
+        id += r.varint();
+        quint8 mask = r.u8();
+
+        copyBaseUntil(id);
+        EntityState e;
+        memset(&e, 0, sizeof(e));
+        if(bi < base.size() && base[bi].id == id)
+            e = base[bi++];
+        e.id = id;
+
+        if(mask & MaskType)
+        {
+            e.type = r.u8();
+            e.alive = r.u8();
+            for(int i = 0; i < 3; i++)
+                e.color[i] = r.u8();
+            e.material = r.u8();
+        }
+        if(mask & MaskPosition)
+            for(int i = 0; i < 3; i++)
+                e.position[i] = qint16(e.position[i] + r.zigzag());
+        if(mask & MaskEnergy)
+            for(int i = 0; i < 3; i++)
+                e.energy[i] = qint16(e.energy[i] + r.zigzag());
+        if(mask & MaskScale)
+            e.scale = quint16(e.scale + r.zigzag());
+        out.entities.push_back(e);
+    }
+    copyBaseUntil(quint64(1) << 32);
+
+    return r.ok();
+}
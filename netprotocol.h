@@ -0,0 +1,67 @@
+#ifndef NETPROTOCOL_H
+#define NETPROTOCOL_H
+
+#include <QByteArray>
+#include <QVector3D>
+#include <functional>
+#include <vector>
+#include "gameobject.h"
+
+namespace Net
+{
+    const quint16 DefaultPort = 27960;
+    const int TickRate = 60;
+    const int SnapshotInterval = 2;     // ticks between snapshots
+    const int HistorySize = 64;         // snapshots kept for delta baselines
+
+    enum PacketType : quint8
+    {
+        InputPacket = 1,
+        SnapshotPacket = 2
+    };
+
+    // client -> server, sent every client tick
+    struct PlayerInput
+    {
+        quint32 sequence = 0;
+        quint32 ackTick = 0;        // newest snapshot the client decoded
+        quint8 buttons = 0;         // Player::Move bits
+        quint8 fireCount = 0;       // wraps, server spawns the difference
+        float phi = 0.0f;
+        float theta = 0.0f;
+    };
+
+    // quantized object state: position 1/256, energy 1/4096, scale 1/1024
+    struct EntityState
+    {
+        quint32 id;
+        quint8 type;
+        quint8 alive;
+        quint8 color[3];
+        quint8 material;        // NoMaterial as 0xFF
+        qint16 position[3];
+        qint16 energy[3];
+        quint16 scale;
+    };
+
+    struct Snapshot
+    {
+        quint32 tick = 0;
+        quint32 inputAck = 0;
+        quint32 playerId = 0;
+        std::vector<EntityState> entities;  // sorted by id
+    };
+
+    EntityState quantize(const GameObject* obj);
+    void dequantize(const EntityState& state, GameObject* obj);
+    QVector3D position(const EntityState& state);
+
+    QByteArray encodeInput(const PlayerInput& input);
+    bool decodeInput(const QByteArray& packet, PlayerInput& input);
+
+    // only entities that differ from baseline are written, baseline may be null
+    QByteArray encodeSnapshot(const Snapshot& current, const Snapshot* baseline);
+    bool decodeSnapshot(const QByteArray& packet, const std::function<const Snapshot*(quint32)>& findBaseline, Snapshot& out);
+}
+
+#endif // NETPROTOCOL_H
@@ -0,0 +1,320 @@
+#include "particlesystem.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QtConcurrent>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define PARTICLES_SSE
+#endif
+
+#ifndef GL_PROGRAM_POINT_SIZE
+#define GL_PROGRAM_POINT_SIZE 0x8642
+#endif
+#ifndef GL_POINT_SPRITE
+#define GL_POINT_SPRITE 0x8861
+#endif
+
+using namespace std;
+
+ParticleSystem::ParticleSystem()
+    : m_seed(12345u), m_program(nullptr)
+{
+    Pool& impact = m_pools[Impact];
+    impact.color = QVector3D(1.0f, 0.6f, 0.2f);
+    impact.lifetime = 0.8f;
+    impact.speed = 2.5f;
+    impact.gravity = -4.0f;
+    impact.drag = 0.98f;
+    impact.pointSize = 40.0f;
+
+    Pool& collision = m_pools[Collision];
+    collision.color = QVector3D(0.6f, 0.8f, 1.0f);
+    collision.lifetime = 0.4f;
+    collision.speed = 1.2f;
+    collision.gravity = -2.0f;
+    collision.drag = 0.95f;
+    collision.pointSize = 25.0f;
+
+    for(int t = 0; t < EmitterTypeCount; t++)
+        reserve(m_pools[t], ChunkSize);
+    m_flashes.reserve(MaxFlashes);
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    for(int t = 0; t < EmitterTypeCount; t++)
+        qFreeAligned(m_pools[t].px);
+}
+
+void ParticleSystem::reserve(Pool &pool, int capacity)
+{
+    capacity = (capacity + 3) & ~3;
+    if(capacity <= pool.capacity)
+        return;
+
+    size_t bytes = size_t(capacity) * sizeof(float);
+    float* block = static_cast<float*>(qMallocAligned(7 * bytes, 16));
+    memset(block, 0, 7 * bytes);
+
+    float* old = pool.px;
+    float** arrays[] = { &pool.px, &pool.py, &pool.pz, &pool.vx, &pool.vy, &pool.vz, &pool.life };
+    for(int a = 0; a < 7; a++)
+    {
+        float* dst = block + size_t(a) * capacity;
+        if(*arrays[a] != nullptr)
+            memcpy(dst, *arrays[a], size_t(pool.count) * sizeof(float));
+        *arrays[a] = dst;
+    }
+
+    qFreeAligned(old);
+    pool.capacity = capacity;
+}
+
+float ParticleSystem::random()
+{
+    // xorshift, uniform in [-1,1]
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return float(m_seed & 0xFFFFFF) / float(0x7FFFFF) - 1.0f;
+}
+
+void ParticleSystem::emit(EmitterType type, const QVector3D &position, const QVector3D &velocity, int count)
+{
+    Pool& pool = m_pools[type];
+    if(pool.count + count > pool.capacity)
+        reserve(pool, qMin(MaxParticles, qMax(pool.capacity * 2, pool.count + count)));
+    count = qMin(count, pool.capacity - pool.count);
+
+    if(type == Impact && m_flashes.size() < MaxFlashes)
+        m_flashes.append({ position, pool.lifetime });
+
+    for(int k = 0; k < count; k++)
+    {
+        int i = pool.count++;
+        QVector3D d(random(), random(), random());
+        d = d.normalized() * pool.speed * (0.5f + 0.5f * fabs(random()));
+
+        pool.px[i] = position.x();
+        pool.py[i] = position.y();
+        pool.pz[i] = position.z();
+        pool.vx[i] = velocity.x() + d.x();
+        pool.vy[i] = velocity.y() + d.y();
+        pool.vz[i] = velocity.z() + d.z();
+        pool.life[i] = pool.lifetime * (0.6f + 0.4f * fabs(random()));
+    }
+}
+
+void ParticleSystem::updateRange(Pool &pool, int begin, int end, float dt)
+{
+    // begin is a multiple of 4, lanes past count are padding and are never read back
+    end = (end + 3) & ~3;
+
+#ifdef PARTICLES_SSE
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vdrag = _mm_set1_ps(pool.drag);
+    const __m128 vgravity = _mm_set1_ps(pool.gravity * dt);
+    for(int i = begin; i < end; i += 4)
+    {
+        __m128 vx = _mm_mul_ps(_mm_load_ps(pool.vx + i), vdrag);
+        __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_load_ps(pool.vy + i), vgravity), vdrag);
+        __m128 vz = _mm_mul_ps(_mm_load_ps(pool.vz + i), vdrag);
+
+        _mm_store_ps(pool.vx + i, vx);
+        _mm_store_ps(pool.vy + i, vy);
+        _mm_store_ps(pool.vz + i, vz);
+        _mm_store_ps(pool.px + i, _mm_add_ps(_mm_load_ps(pool.px + i), _mm_mul_ps(vx, vdt)));
+        _mm_store_ps(pool.py + i, _mm_add_ps(_mm_load_ps(pool.py + i), _mm_mul_ps(vy, vdt)));
+        _mm_store_ps(pool.pz + i, _mm_add_ps(_mm_load_ps(pool.pz + i), _mm_mul_ps(vz, vdt)));
+        _mm_store_ps(pool.life + i, _mm_sub_ps(_mm_load_ps(pool.life + i), vdt));
+    }
+#else
+    for(int i = begin; i < end; i++)
+    {
+        pool.vx[i] = pool.vx[i] * pool.drag;
+        pool.vy[i] = (pool.vy[i] + pool.gravity * dt) * pool.drag;
+        pool.vz[i] = pool.vz[i] * pool.drag;
+        pool.px[i] += pool.vx[i] * dt;
+        pool.py[i] += pool.vy[i] * dt;
+        pool.pz[i] += pool.vz[i] * dt;
+        pool.life[i] -= dt;
+    }
+#endif
+}
+
+void ParticleSystem::compact(Pool &pool)
+{
+    for(int i = 0; i < pool.count;)
+    {
+        if(pool.life[i] > 0.0f)
+        {
+            i++;
+            continue;
+        }
+
+        int last = --pool.count;
+        pool.px[i] = pool.px[last];
+        pool.py[i] = pool.py[last];
+        pool.pz[i] = pool.pz[last];
+        pool.vx[i] = pool.vx[last];
+        pool.vy[i] = pool.vy[last];
+        pool.vz[i] = pool.vz[last];
+        pool.life[i] = pool.life[last];
+    }
+}
+
+void ParticleSystem::update(float dt)
+{
+    for(int i = 0; i < m_flashes.size();)
+    {
+        m_flashes[i].life -= dt;
+        if(m_flashes[i].life > 0)
+            i++;
+        else
+        {
+            m_flashes[i] = m_flashes.last();
+            m_flashes.removeLast();
+        }
+    }
+
+    for(int t = 0; t < EmitterTypeCount; t++)
+    {
+        Pool& pool = m_pools[t];
+        if(pool.count == 0)
+            continue;
+
+        if(pool.count <= ChunkSize)
+        {
+            updateRange(pool, 0, pool.count, dt);
+        }
+        else
+        {
+            m_chunkStarts.resize(0);
+            for(int begin = 0; begin < pool.count; begin += ChunkSize)
+                m_chunkStarts.append(begin);
+
+            QtConcurrent::blockingMap(m_chunkStarts, [&pool, dt](int begin)
+            {
+                updateRange(pool, begin, qMin(begin + ChunkSize, pool.count), dt);
+            });
+        }
+
+        compact(pool);
+    }
+}
+
+void ParticleSystem::clear()
+{
+    for(int t = 0; t < EmitterTypeCount; t++)
+        m_pools[t].count = 0;
+    m_flashes.clear();
+}
+
+int ParticleSystem::liveCount() const
+{
+    int count = 0;
+    for(int t = 0; t < EmitterTypeCount; t++)
+        count += m_pools[t].count;
+    return count;
+}
+
+int ParticleSystem::liveCount(EmitterType type) const
+{
+    return m_pools[type].count;
+}
+
+void ParticleSystem::initGL()
+{
+    m_program = new QOpenGLShaderProgram;
+    m_program->addShaderFromSourceFile(QOpenGLShader::Vertex, "resources/particle.vs");
+    m_program->addShaderFromSourceFile(QOpenGLShader::Fragment, "resources/particle.fs");
+    m_program->bindAttributeLocation("px", 0);
+    m_program->bindAttributeLocation("py", 1);
+    m_program->bindAttributeLocation("pz", 2);
+    m_program->bindAttributeLocation("life", 3);
+    m_program->link();
+
+    m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+    m_viewMatrixLoc = m_program->uniformLocation("viewMatrix");
+    m_colorLoc = m_program->uniformLocation("color");
+    m_lifetimeLoc = m_program->uniformLocation("lifetime");
+    m_pointSizeLoc = m_program->uniformLocation("pointSize");
+
+    m_vao.create();
+    m_vbo.create();
+    m_vbo.setUsagePattern(QOpenGLBuffer::StreamDraw);
+}
+
+void ParticleSystem::cleanupGL()
+{
+    m_vbo.destroy();
+    m_vao.destroy();
+    delete m_program;
+    m_program = nullptr;
+}
+
+void ParticleSystem::render(const QMatrix4x4 &proj, const QMatrix4x4 &view, float pointScale)
+{
+    if(m_program == nullptr || liveCount() == 0)
+        return;
+
+    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+    bool desktop = !QOpenGLContext::currentContext()->isOpenGLES();
+    if(desktop)
+    {
+        f->glEnable(GL_PROGRAM_POINT_SIZE);
+        f->glEnable(GL_POINT_SPRITE);
+    }
+    f->glEnable(GL_BLEND);
+    f->glBlendFunc(GL_ONE, GL_ONE);
+    f->glDepthMask(GL_FALSE);
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    m_program->bind();
+    m_program->setUniformValue(m_projMatrixLoc, proj);
+    m_program->setUniformValue(m_viewMatrixLoc, view);
+    m_vbo.bind();
+
+    for(int a = 0; a < 4; a++)
+        f->glEnableVertexAttribArray(a);
+
+    // one point sprite draw per emitter type, the SoA arrays are uploaded as they are
+    for(int t = 0; t < EmitterTypeCount; t++)
+    {
+        Pool& pool = m_pools[t];
+        if(pool.count == 0)
+            continue;
+
+        int bytes = pool.count * int(sizeof(float));
+        m_vbo.allocate(4 * bytes);
+        const float* arrays[] = { pool.px, pool.py, pool.pz, pool.life };
+        for(int a = 0; a < 4; a++)
+        {
+            m_vbo.write(a * bytes, arrays[a], bytes);
+            f->glVertexAttribPointer(a, 1, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void *>(size_t(a) * bytes));
+        }
+
+        m_program->setUniformValue(m_colorLoc, pool.color);
+        m_program->setUniformValue(m_lifetimeLoc, pool.lifetime);
+        m_program->setUniformValue(m_pointSizeLoc, pool.pointSize * pointScale);
+        f->glDrawArrays(GL_POINTS, 0, pool.count);
+    }
+
+    for(int a = 0; a < 4; a++)
+        f->glDisableVertexAttribArray(a);
+
+    m_vbo.release();
+    m_program->release();
+
+    f->glDepthMask(GL_TRUE);
+    f->glDisable(GL_BLEND);
+    if(desktop)
+    {
+        f->glDisable(GL_PROGRAM_POINT_SIZE);
+        f->glDisable(GL_POINT_SPRITE);
+    }
+}
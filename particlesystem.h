@@ -0,0 +1,91 @@
+#ifndef PARTICLESYSTEM_H
+#define PARTICLESYSTEM_H
+
+#include <QVector3D>
+#include <QMatrix4x4>
+#include <QVector>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+
+class ParticleSystem
+{
+public:
+    enum EmitterType
+    {
+        Impact,
+        Collision,
+        EmitterTypeCount
+    };
+
+    // short lived light left behind by an impact burst
+    struct Flash
+    {
+        QVector3D position;
+        float life;
+    };
+
+    ParticleSystem();
+    ~ParticleSystem();
+
+    void emit(EmitterType type, const QVector3D& position, const QVector3D& velocity, int count);
+    void update(float dt);
+    void clear();
+
+    void initGL();
+    void cleanupGL();
+    // pointScale follows the render resolution, sprite sizes are in pixels
+    void render(const QMatrix4x4& proj, const QMatrix4x4& view, float pointScale = 1.0f);
+
+    int liveCount() const;
+    int liveCount(EmitterType type) const;
+    const QVector<Flash>& flashes() const { return m_flashes; }
+
+    static const int ChunkSize = 16384;
+    static const int MaxParticles = 1 << 20;
+    static const int MaxFlashes = 64;
+
+private:
+    // structure of arrays, every array is 16 byte aligned and padded to a multiple of 4
+    struct Pool
+    {
+        float* px = nullptr;
+        float* py = nullptr;
+        float* pz = nullptr;
+        float* vx = nullptr;
+        float* vy = nullptr;
+        float* vz = nullptr;
+        float* life = nullptr;
+        int count = 0;
+        int capacity = 0;
+
+        QVector3D color;
+        float lifetime;
+        float speed;
+        float gravity;
+        float drag;
+        float pointSize;
+    };
+
+    void reserve(Pool& pool, int capacity);
+    static void updateRange(Pool& pool, int begin, int end, float dt);
+    static void compact(Pool& pool);
+    float random();
+
+    Pool m_pools[EmitterTypeCount];
+    QVector<int> m_chunkStarts;
+    QVector<Flash> m_flashes;
+    unsigned m_seed;
+
+    QOpenGLShaderProgram* m_program;
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vbo;
+    int m_projMatrixLoc;
+    int m_viewMatrixLoc;
+    int m_colorLoc;
+    int m_lifetimeLoc;
+    int m_pointSizeLoc;
+};
+
+#endif // PARTICLESYSTEM_H
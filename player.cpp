@@ -1,18 +1,23 @@
 #include "player.h"
+#include <math.h>
 
 Player::Player()
 {
     position = QVector3D(0,0,0);
     direction = QVector3D(0,0,-1);
+    phi = atan2(direction.z(), direction.x());
+    theta = acos(direction.y());
     speed = 0.01f;
+    m_name = "Player";
+    setLayer(Collision::PlayerLayer);
 }
 
 void Player::init()
 {
-    m_mesh=CMesh::m_meshes["bunny"];
+    static const AssetName mesh("bunny");
+    m_mesh=CMesh::find(mesh);
     scale = QVector3D(0.1f,0.1f,0.1f);
     m_radius = 0.1f;
-    m_name = "Player";
 }
 
 void Player::render(GLWidget *glwidget)
@@ -25,3 +30,44 @@ void Player::update()
     position = position + energy;
     energy = energy/1.2f;
 }
+
+void Player::look(float dPhi, float dTheta)
+{
+    phi = phi + dPhi;
+    theta = theta + dTheta;
+    if(theta<0.01f)theta=0.01f;
+    if(theta>3.14f)theta=3.14f;
+
+    direction.setX(sin(theta) * cos(phi));
+    direction.setY(cos(theta));
+    direction.setZ(sin(theta) * sin(phi));
+}
+
+void Player::move(quint8 buttons)
+{
+    if(buttons & Forward)
+    {
+        energy.setX(energy.x() + direction.x() * speed);
+        energy.setZ(energy.z() + direction.z() * speed);
+    }
+    if(buttons & Back)
+    {
+        energy.setX(energy.x() - direction.x() * speed);
+        energy.setZ(energy.z() - direction.z() * speed);
+    }
+    if(buttons & Left)
+    {
+        energy.setX(energy.x() + direction.z() * speed);
+        energy.setZ(energy.z() - direction.x() * speed);
+    }
+    if(buttons & Right)
+    {
+        energy.setX(energy.x() - direction.z() * speed);
+        energy.setZ(energy.z() + direction.x() * speed);
+    }
+}
+
+GameObject::Type Player::type() const
+{
+    return PlayerType;
+}
@@ -10,14 +10,26 @@ class Player:public GameObject
 public:
     Player();
 
+    enum Move : quint8
+    {
+        Forward = 1,
+        Back = 2,
+        Left = 4,
+        Right = 8
+    };
+
     QVector3D direction;
+    float phi;
+    float theta;
     float speed;
 
+    void look(float dPhi, float dTheta);
+    void move(quint8 buttons);
+
     void init();
     void render(GLWidget* glwidget);
     void update();
-
-    CMesh* m_mesh;
+    Type type() const;
 };
 
 #endif // PLAYER_H
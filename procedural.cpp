@@ -0,0 +1,293 @@
+#include "procedural.h"
+#include "cmesh.h"
+#include <QtConcurrent>
+#include <QtMath>
+#include <math.h>
+
+using namespace std;
+
+namespace
+{
+    const int RowsPerTask = 32;
+
+    struct TrigTable
+    {
+        std::vector<float> sin;
+        std::vector<float> cos;
+
+        // steps + 1 entries from 0 to degrees
+        TrigTable(int steps, float degrees)
+            : sin(size_t(steps + 1)), cos(size_t(steps + 1))
+        {
+            for(int i = 0; i <= steps; i++)
+            {
+                float a = qDegreesToRadians(degrees * float(i) / float(steps));
+                sin[size_t(i)] = sinf(a);
+                cos[size_t(i)] = cosf(a);
+            }
+            // a full turn ends exactly where it started, so the seam columns coincide
+            if(degrees == 360.0f)
+            {
+                sin[size_t(steps)] = sin[0];
+                cos[size_t(steps)] = cos[0];
+            }
+        }
+    };
+
+    // calls fill(begin, end) for ranges of rows, on the thread pool when there are enough
+    template<typename Function>
+    void forRows(int rows, Function fill)
+    {
+        if(rows <= RowsPerTask)
+        {
+            fill(0, rows);
+            return;
+        }
+
+        QVector<int> starts;
+        for(int begin = 0; begin < rows; begin += RowsPerTask)
+            starts.append(begin);
+        QtConcurrent::blockingMap(starts, [&fill, rows](int begin)
+        {
+            fill(begin, qMin(begin + RowsPerTask, rows));
+        });
+    }
+
+    // two triangles per cell of a (columns + 1) wide vertex grid whose rows run along +z,
+    // counter clockwise seen from +y
+    void gridIndices(GLuint* indices, int columns, int rowBegin, int rowEnd)
+    {
+        GLuint* out = indices + size_t(rowBegin) * columns * 6;
+        for(int r = rowBegin; r < rowEnd; r++)
+        {
+            for(int c = 0; c < columns; c++)
+            {
+                GLuint a = GLuint(r * (columns + 1) + c);
+                GLuint b = a + GLuint(columns + 1);
+                *out++ = a;
+                *out++ = b;
+                *out++ = a + 1;
+                *out++ = a + 1;
+                *out++ = b;
+                *out++ = b + 1;
+            }
+        }
+    }
+
+    // rows of latitude from the north to the south pole, with an extra row at the equator
+    // that is moved by halfHeight up and down when a cylinder goes in between
+    void latLong(CMesh& mesh, float radius, float halfHeight, int segments, int rings)
+    {
+        segments = qMax(3, segments);
+        rings = qMax(2, rings + (rings & 1));
+        bool capsule = halfHeight > 0.0f;
+        int rows = rings + 1 + (capsule ? 1 : 0);
+
+        TrigTable phi(segments, 360.0f);
+        TrigTable theta(rings, 180.0f);
+
+        // the bands touching a pole need one triangle per cell instead of two
+        int bands = rows - 1;
+        CMesh::StagingVertex* vertices = mesh.stageVertices(rows * (segments + 1));
+        GLuint* indices = mesh.stageIndices((bands * 2 - 2) * segments * 3);
+
+        forRows(rows, [&](int begin, int end)
+        {
+            for(int r = begin; r < end; r++)
+            {
+                int ring = capsule && r > rings / 2 ? r - 1 : r;
+                float y = capsule ? (r > rings / 2 ? -halfHeight : halfHeight) : 0.0f;
+                float sinTheta = theta.sin[size_t(ring)];
+                float cosTheta = theta.cos[size_t(ring)];
+                float v = 1.0f - float(r) / float(rows - 1);
+
+                CMesh::StagingVertex* out = vertices + size_t(r) * (segments + 1);
+                for(int s = 0; s <= segments; s++)
+                {
+                    QVector3D n(sinTheta * phi.cos[size_t(s)], cosTheta, -sinTheta * phi.sin[size_t(s)]);
+                    out[s].position = n * radius + QVector3D(0.0f, y, 0.0f);
+                    out[s].normal = n;
+                    out[s].uv = QVector2D(float(s) / float(segments), v);
+                }
+            }
+
+            for(int r = begin; r < qMin(end, bands); r++)
+            {
+                GLuint* out = indices + size_t(r == 0 ? 0 : (r * 2 - 1) * segments * 3);
+                for(int s = 0; s < segments; s++)
+                {
+                    GLuint a = GLuint(r * (segments + 1) + s);
+                    GLuint b = a + GLuint(segments + 1);
+                    if(r != 0)
+                    {
+                        *out++ = a;
+                        *out++ = b;
+                        *out++ = a + 1;
+                    }
+                    if(r != bands - 1)
+                    {
+                        *out++ = a + 1;
+                        *out++ = b;
+                        *out++ = b + 1;
+                    }
+                }
+            }
+        });
+
+        mesh.setPrimitive(GL_TRIANGLES);
+    }
+}
+
+void Procedural::sphere(CMesh &mesh, float radius, int segments, int rings)
+{
+    latLong(mesh, radius, 0.0f, segments, rings);
+}
+
+void Procedural::capsule(CMesh &mesh, float radius, float height, int segments, int rings)
+{
+    latLong(mesh, radius, qMax(0.0f, height * 0.5f), segments, rings);
+}
+
+void Procedural::box(CMesh &mesh, const QVector3D &size)
+{
+    // per face: normal, then the u and v directions so that u x v = normal
+    static const float faces[6][9] = {
+        {  0,  0,  1,    1,  0,  0,    0,  1,  0 },
+        {  0,  0, -1,   -1,  0,  0,    0,  1,  0 },
+        {  1,  0,  0,    0,  0, -1,    0,  1,  0 },
+        { -1,  0,  0,    0,  0,  1,    0,  1,  0 },
+        {  0,  1,  0,    1,  0,  0,    0,  0, -1 },
+        {  0, -1,  0,    1,  0,  0,    0,  0,  1 }
+    };
+    static const float corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+    QVector3D half = size * 0.5f;
+    CMesh::StagingVertex* vertices = mesh.stageVertices(24);
+    GLuint* indices = mesh.stageIndices(36);
+
+    for(int f = 0; f < 6; f++)
+    {
+        QVector3D n(faces[f][0], faces[f][1], faces[f][2]);
+        QVector3D u(faces[f][3], faces[f][4], faces[f][5]);
+        QVector3D v(faces[f][6], faces[f][7], faces[f][8]);
+        for(int c = 0; c < 4; c++)
+        {
+            float s = corners[c][0];
+            float t = corners[c][1];
+            QVector3D p = n + u * (s * 2.0f - 1.0f) + v * (t * 2.0f - 1.0f);
+            CMesh::StagingVertex& out = vertices[f * 4 + c];
+            out.position = p * half;
+            out.normal = n;
+            out.uv = QVector2D(s, t);
+        }
+
+        GLuint base = GLuint(f * 4);
+        GLuint* out = indices + f * 6;
+        out[0] = base;
+        out[1] = base + 1;
+        out[2] = base + 2;
+        out[3] = base;
+        out[4] = base + 2;
+        out[5] = base + 3;
+    }
+
+    mesh.setPrimitive(GL_TRIANGLES);
+}
+
+void Procedural::plane(CMesh &mesh, float width, float depth, int columns, int rows)
+{
+    terrain(mesh, width, depth, columns, rows, nullptr);
+}
+
+void Procedural::terrain(CMesh &mesh, float width, float depth, int columns, int rows, const float *heights)
+{
+    columns = qMax(1, columns);
+    rows = qMax(1, rows);
+    int stride = columns + 1;
+    float dx = width / columns;
+    float dz = depth / rows;
+
+    CMesh::StagingVertex* vertices = mesh.stageVertices(stride * (rows + 1));
+    GLuint* indices = mesh.stageIndices(columns * rows * 6);
+
+    auto height = [heights, stride, columns, rows](int c, int r)
+    {
+        return heights[qBound(0, r, rows) * stride + qBound(0, c, columns)];
+    };
+
+    // rows run from z = -depth/2 to +depth/2, toward the viewer, so the cells face up
+    forRows(rows + 1, [&](int begin, int end)
+    {
+        for(int r = begin; r < end; r++)
+        {
+            CMesh::StagingVertex* out = vertices + size_t(r) * stride;
+            float z = -depth * 0.5f + r * dz;
+            for(int c = 0; c <= columns; c++)
+            {
+                out[c].position = QVector3D(-width * 0.5f + c * dx, heights != nullptr ? height(c, r) : 0.0f, z);
+                out[c].uv = QVector2D(float(c) / columns, 1.0f - float(r) / rows);
+                if(heights == nullptr)
+                {
+                    out[c].normal = QVector3D(0.0f, 1.0f, 0.0f);
+                    continue;
+                }
+                // central differences, one sided at the border
+                float hx = (height(c + 1, r) - height(c - 1, r)) / ((qMin(c + 1, columns) - qMax(c - 1, 0)) * dx);
+                float hz = (height(c, r + 1) - height(c, r - 1)) / ((qMin(r + 1, rows) - qMax(r - 1, 0)) * dz);
+                out[c].normal = QVector3D(-hx, 1.0f, -hz).normalized();
+            }
+        }
+        gridIndices(indices, columns, begin, qMin(end, rows));
+    });
+
+    mesh.setPrimitive(GL_TRIANGLES);
+}
+
+std::vector<float> Procedural::noiseHeights(int columns, int rows, int octaves, quint32 seed)
+{
+    int stride = columns + 1;
+    std::vector<float> heights(size_t(stride) * (rows + 1));
+
+    // value noise on an integer lattice, hashed so any sample can be computed on its own
+    auto lattice = [seed](int x, int y)
+    {
+        quint32 h = quint32(x) * 374761393u + quint32(y) * 668265263u + seed * 2246822519u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return float((h ^ (h >> 16)) & 0xFFFF) / 65535.0f;
+    };
+    auto noise = [&lattice](float x, float y)
+    {
+        int x0 = int(floorf(x));
+        int y0 = int(floorf(y));
+        float fx = x - x0;
+        float fy = y - y0;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fy = fy * fy * (3.0f - 2.0f * fy);
+        float a = lattice(x0, y0) + (lattice(x0 + 1, y0) - lattice(x0, y0)) * fx;
+        float b = lattice(x0, y0 + 1) + (lattice(x0 + 1, y0 + 1) - lattice(x0, y0 + 1)) * fx;
+        return a + (b - a) * fy;
+    };
+
+    float base = 4.0f / qMax(columns, rows);
+    forRows(rows + 1, [&](int begin, int end)
+    {
+        for(int r = begin; r < end; r++)
+        {
+            for(int c = 0; c <= columns; c++)
+            {
+                float sum = 0.0f;
+                float amplitude = 0.5f;
+                float frequency = base;
+                for(int o = 0; o < octaves; o++)
+                {
+                    sum += noise(c * frequency, r * frequency) * amplitude;
+                    amplitude *= 0.5f;
+                    frequency *= 2.0f;
+                }
+                heights[size_t(r) * stride + c] = sum;
+            }
+        }
+    });
+
+    return heights;
+}
@@ -0,0 +1,29 @@
+#ifndef PROCEDURAL_H
+#define PROCEDURAL_H
+
+#include <QVector3D>
+#include <vector>
+
+class CMesh;
+
+// indexed triangle meshes generated straight into the mesh's pre-sized staging buffers;
+// sin and cos come from tables built once per call, one entry per column and per row,
+// and the rows are filled in parallel
+namespace Procedural
+{
+    // uv sphere, the seam column is duplicated so u runs from 0 to 1 without a jump
+    void sphere(CMesh& mesh, float radius, int segments, int rings);
+    // hemispheres of radius above and below a cylinder of the given height, along y
+    void capsule(CMesh& mesh, float radius, float height, int segments, int rings);
+    // 24 vertices, each face with its own normal and full uv square
+    void box(CMesh& mesh, const QVector3D& size);
+    // in the xz plane facing up, columns x rows cells
+    void plane(CMesh& mesh, float width, float depth, int columns, int rows);
+    // a plane displaced by (columns + 1) x (rows + 1) heights, row by row
+    void terrain(CMesh& mesh, float width, float depth, int columns, int rows, const float* heights);
+
+    // fractal value noise in [0,1] for terrain, (columns + 1) x (rows + 1) samples
+    std::vector<float> noiseHeights(int columns, int rows, int octaves, quint32 seed);
+}
+
+#endif // PROCEDURAL_H
@@ -0,0 +1,267 @@
+#include "savegame.h"
+#include "simulation.h"
+#include "player.h"
+#include "texturemanager.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+using namespace std;
+
+static_assert(sizeof(SaveGame::Header) == 56, "save header layout changed, bump SaveGame::Version");
+static_assert(sizeof(SaveGame::ObjectRecord) == 72, "save record layout changed, bump SaveGame::Version");
+
+quint32 SaveGame::s_lastEpoch = 0;
+
+SaveGame::SaveGame()
+    : m_state(Idle), m_simulation(nullptr), m_epoch(0), m_cursor(0)
+{
+}
+
+SaveGame::~SaveGame()
+{
+    if(m_state == Encoding)
+        m_simulation->setSaveCapture(nullptr);
+    m_write.waitForFinished();
+}
+
+bool SaveGame::isBusy() const
+{
+    return m_state != Idle;
+}
+
+bool SaveGame::begin(const QString &path, Simulation *simulation, Player &player, char cameraType)
+{
+    if(m_state != Idle)
+        return false;
+
+    // only the object list is copied now, the records follow over the next ticks
+    m_path = path;
+    m_simulation = simulation;
+    m_epoch = ++s_lastEpoch;
+    m_objects = simulation->m_gameObjects;
+    m_preserved.clear();
+    m_fileMaterial.assign(TextureManager::m_materials.size(), quint16(NoMaterial));
+    m_materialNames.clear();
+    m_cursor = 0;
+    m_data.resize(int(sizeof(Header) + m_objects.size() * sizeof(ObjectRecord)));
+
+    Header* header = reinterpret_cast<Header*>(m_data.data());
+    memset(header, 0, sizeof(Header));
+    memcpy(header->magic, "GSAV", 4);
+    header->version = Version;
+    header->recordSize = sizeof(ObjectRecord);
+    header->objectCount = quint32(m_objects.size());
+    header->tick = simulation->m_tick;
+    for(int i = 0; i < 3; i++)
+        header->playerDirection[i] = player.direction[i];
+    header->playerPhi = player.phi;
+    header->playerTheta = player.theta;
+    header->cameraType = quint8(cameraType);
+
+    // the player also moves outside of Simulation::step
+    preserve(&player);
+    m_simulation->setSaveCapture(this);
+    m_state = Encoding;
+    return true;
+}
+
+void SaveGame::copyOnWrite(GameObject *obj)
+{
+    // objects created after begin get a copy too, it is just never looked up
+    obj->m_saveEpoch = m_epoch;
+    obj->m_saveRecord = quint32(m_preserved.size());
+    m_preserved.emplace_back();
+    encode(obj, m_preserved.back());
+}
+
+void SaveGame::encode(const GameObject *obj, ObjectRecord &r)
+{
+    r.type = obj->type();
+    r.alive = obj->isAlive ? 1 : 0;
+    r.material = NoMaterial;
+    // materials used by the world get consecutive file indices, stored by name
+    // because indices are only stable within one build
+    if(obj->m_material >= 0 && size_t(obj->m_material) < m_fileMaterial.size())
+    {
+        quint16& index = m_fileMaterial[obj->m_material];
+        if(index == NoMaterial)
+        {
+            index = quint16(m_materialNames.size());
+            m_materialNames.push_back(TextureManager::m_materials[obj->m_material].name);
+        }
+        r.material = index;
+    }
+    r.id = obj->m_id;
+    for(int i = 0; i < 3; i++)
+    {
+        r.position[i] = obj->position[i];
+        r.rotation[i] = obj->rotation[i];
+        r.scale[i] = obj->scale[i];
+        r.energy[i] = obj->energy[i];
+        r.color[i] = obj->material_color[i];
+    }
+    r.radius = obj->m_radius;
+}
+
+void SaveGame::step()
+{
+    if(m_state == Writing && m_write.isFinished())
+    {
+        cout << "Saving " << m_path.toStdString() << " - " << (m_write.result() ? "Done!" : "Failed!") << endl;
+        m_state = Idle;
+    }
+    if(m_state != Encoding)
+        return;
+
+    // objects unchanged since begin are encoded as they are, the rest from their copy
+    ObjectRecord* records = reinterpret_cast<ObjectRecord*>(m_data.data() + sizeof(Header));
+    size_t end = std::min(m_cursor + RecordsPerTick, m_objects.size());
+    for(; m_cursor < end; m_cursor++)
+    {
+        GameObject* obj = m_objects[m_cursor];
+        if(obj->m_saveEpoch == m_epoch)
+        {
+            records[m_cursor] = m_preserved[obj->m_saveRecord];
+        }
+        else
+        {
+            encode(obj, records[m_cursor]);
+            obj->m_saveEpoch = m_epoch;
+        }
+    }
+
+    if(m_cursor == m_objects.size())
+        finish();
+}
+
+void SaveGame::finish()
+{
+    // dead objects parked during the capture are deleted now
+    m_simulation->setSaveCapture(nullptr);
+    m_objects.clear();
+    m_preserved.clear();
+
+    Header* header = reinterpret_cast<Header*>(m_data.data());
+    header->materialCount = quint32(m_materialNames.size());
+    header->materialTableOffset = quint64(m_data.size());
+
+    // until the write is finished the buffer belongs to the worker
+    m_write = QtConcurrent::run([this]()
+    {
+        for(const std::string& name : m_materialNames)
+        {
+            quint16 length = quint16(name.size());
+            m_data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            m_data.append(name.data(), int(length));
+        }
+
+        QSaveFile file(m_path);
+        bool written = file.open(QIODevice::WriteOnly) && file.write(m_data) == m_data.size() && file.commit();
+        m_data.clear();
+        return written;
+    });
+    m_state = Writing;
+}
+
+bool SaveGame::load(const QString &path, Simulation &simulation, Player &player, char &cameraType)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header)))
+    {
+        cout << "Loading " << path.toStdString() << " - Not Found!" << endl;
+        return false;
+    }
+
+    qint64 size = file.size();
+    const uchar* data = file.map(0, size);
+    if(data == nullptr)
+        return false;
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+    quint64 recordsEnd = sizeof(Header) + quint64(header->objectCount) * sizeof(ObjectRecord);
+    if(memcmp(header->magic, "GSAV", 4) != 0 || header->version != Version ||
+       header->recordSize != sizeof(ObjectRecord) || recordsEnd > header->materialTableOffset ||
+       header->materialTableOffset > quint64(size))
+    {
+        cout << "Loading " << path.toStdString() << " - Unsupported format!" << endl;
+        return false;
+    }
+
+    std::vector<qint16> materials;
+    const uchar* p = data + header->materialTableOffset;
+    const uchar* end = data + size;
+    for(quint32 i = 0; i < header->materialCount && p + sizeof(quint16) <= end; i++)
+    {
+        quint16 length;
+        memcpy(&length, p, sizeof(length));
+        p += sizeof(length);
+        if(p + length > end)
+            break;
+        materials.push_back(TextureManager::getMaterial(std::string(reinterpret_cast<const char*>(p), length)));
+        p += length;
+    }
+
+    // one initialized prototype per type, every other object is a copy of it
+    GameObject* prototypes[GameObject::BulletType + 1] = {};
+    const ObjectRecord* records = reinterpret_cast<const ObjectRecord*>(data + sizeof(Header));
+    std::vector<GameObject*> objects;
+    objects.reserve(header->objectCount + 1);
+    bool playerRestored = false;
+
+    for(quint32 n = 0; n < header->objectCount; n++)
+    {
+        const ObjectRecord& r = records[n];
+        if(r.type > GameObject::BulletType)
+            continue;
+
+        GameObject* obj;
+        if(r.type == GameObject::PlayerType && !playerRestored)
+        {
+            obj = &player;
+            playerRestored = true;
+        }
+        else
+        {
+            if(prototypes[r.type] == nullptr)
+            {
+                prototypes[r.type] = simulation.createObject(GameObject::Type(r.type));
+                prototypes[r.type]->init();
+            }
+            obj = simulation.cloneObject(prototypes[r.type]);
+        }
+
+        obj->m_id = r.id;
+        obj->isAlive = r.alive != 0;
+        obj->position = QVector3D(r.position[0], r.position[1], r.position[2]);
+        obj->rotation = QVector3D(r.rotation[0], r.rotation[1], r.rotation[2]);
+        obj->scale = QVector3D(r.scale[0], r.scale[1], r.scale[2]);
+        obj->energy = QVector3D(r.energy[0], r.energy[1], r.energy[2]);
+        obj->material_color = QVector3D(r.color[0], r.color[1], r.color[2]);
+        obj->m_radius = r.radius;
+        obj->m_material = r.material < materials.size() ? materials[r.material] : TextureManager::NoMaterial;
+        objects.push_back(obj);
+    }
+
+    for(GameObject* prototype : prototypes)
+        delete prototype;
+
+    if(!playerRestored)
+        objects.insert(objects.begin(), &player);
+    player.phi = header->playerPhi;
+    player.theta = header->playerTheta;
+    player.direction = QVector3D(header->playerDirection[0], header->playerDirection[1], header->playerDirection[2]);
+    cameraType = char(header->cameraType);
+    quint32 tick = header->tick;
+    size_t count = objects.size();
+    file.unmap(const_cast<uchar*>(data));
+
+    simulation.clear(&player);
+    simulation.restore(std::move(objects), tick);
+
+    cout << "Loading " << path.toStdString() << " - " << count << " objects" << endl;
+    return true;
+}
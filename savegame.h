@@ -0,0 +1,103 @@
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+
+#include <QByteArray>
+#include <QFuture>
+#include <QString>
+#include <string>
+#include <vector>
+#include "gameobject.h"
+
+class Simulation;
+class Player;
+
+// versioned binary world snapshot:
+// header | object records | material name table
+// records are plain structs so loading works directly on the mapped file
+class SaveGame
+{
+public:
+    static const quint32 Version = 2;
+    static const int RecordsPerTick = 65536;
+
+    struct Header
+    {
+        char magic[4];
+        quint32 version;
+        quint32 recordSize;
+        quint32 objectCount;
+        quint32 tick;
+        quint32 materialCount;
+        quint64 materialTableOffset;
+        float playerDirection[3];
+        float playerPhi;
+        float playerTheta;
+        quint8 cameraType;
+        quint8 reserved[3];
+    };
+
+    struct ObjectRecord
+    {
+        quint8 type;
+        quint8 alive;
+        quint16 material;   // index into the material table, NoMaterial if none
+        quint32 id;
+        float position[3];
+        float rotation[3];
+        float scale[3];
+        float energy[3];
+        float color[3];
+        float radius;
+    };
+
+    static const quint16 NoMaterial = 0xFFFF;
+
+    SaveGame();
+    ~SaveGame();
+
+    // starts an incremental save of the world as it is at this tick: step() encodes
+    // RecordsPerTick records per tick, and the simulation hands over every object it
+    // is about to change before then, so no record sees a later tick; the material
+    // table and the file are written in the background once all records are in
+    bool begin(const QString& path, Simulation* simulation, Player& player, char cameraType);
+    void step();
+    bool isBusy() const;
+
+    // keeps the state obj has at the start of the save, called before it changes
+    void preserve(GameObject* obj)
+    {
+        if(obj->m_saveEpoch != m_epoch)
+            copyOnWrite(obj);
+    }
+
+    static bool load(const QString& path, Simulation& simulation, Player& player, char& cameraType);
+
+private:
+    void copyOnWrite(GameObject* obj);
+    void encode(const GameObject* obj, ObjectRecord& r);
+    void finish();
+
+    enum State
+    {
+        Idle,
+        Encoding,
+        Writing
+    };
+
+    // shared by every save so an object never carries a mark that matches a new save
+    static quint32 s_lastEpoch;
+
+    State m_state;
+    QString m_path;
+    Simulation* m_simulation;
+    quint32 m_epoch;
+    std::vector<GameObject*> m_objects;     // the objects at begin, in record order
+    std::vector<ObjectRecord> m_preserved;  // records copied before a change, by m_saveRecord
+    std::vector<quint16> m_fileMaterial;    // material index to file index
+    size_t m_cursor;
+    QByteArray m_data;
+    std::vector<std::string> m_materialNames;
+    QFuture<bool> m_write;
+};
+
+#endif // SAVEGAME_H
@@ -0,0 +1,448 @@
+#include "simulation.h"
+#include "player.h"
+#include "bullet.h"
+#include "cube.h"
+#include "particlesystem.h"
+#include "texturemanager.h"
+#include "savegame.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+Simulation::Simulation()
+    : m_particles(nullptr), m_tick(0), m_lodTicks(nullptr), m_lodCursor(0), m_grid(), m_saveCapture(nullptr), m_nextId(1)
+{
+}
+
+void Simulation::addObject(GameObject *obj)
+{
+    obj->m_id = m_nextId++;
+    obj->m_lodTick = m_tick;
+    obj->init();
+    m_gameObjects.push_back(obj);
+}
+
+void Simulation::removeObject(GameObject *obj)
+{
+    m_gameObjects.erase(std::remove(m_gameObjects.begin(), m_gameObjects.end(), obj), m_gameObjects.end());
+}
+
+GameObject* Simulation::createObject(GameObject::Type type)
+{
+    switch(type)
+    {
+    case GameObject::PlayerType:
+        return new Player();
+    case GameObject::CubeType:
+    {
+        Cube* cube = new Cube();
+        cube->m_material = TextureManager::getMaterial("brick");
+        return cube;
+    }
+    case GameObject::BulletType:
+        return new Bullet();
+    }
+    return nullptr;
+}
+
+GameObject* Simulation::cloneObject(const GameObject *prototype)
+{
+    GameObject* clone = nullptr;
+    switch(prototype->type())
+    {
+    case GameObject::PlayerType:
+        clone = new Player(*static_cast<const Player*>(prototype));
+        break;
+    case GameObject::CubeType:
+        clone = new Cube(*static_cast<const Cube*>(prototype));
+        break;
+    case GameObject::BulletType:
+        clone = new Bullet(*static_cast<const Bullet*>(prototype));
+        break;
+    }
+    // a clone starts its own step history, not the prototype's
+    if(clone != nullptr)
+        clone->m_lodTick = m_tick;
+    return clone;
+}
+
+void Simulation::clear(const GameObject *keep)
+{
+    for(GameObject* obj : m_gameObjects)
+    {
+        if(obj != keep)
+            delete obj;
+    }
+    m_gameObjects.clear();
+}
+
+void Simulation::restore(std::vector<GameObject *> &&objects, quint32 tick)
+{
+    m_gameObjects = std::move(objects);
+    m_tick = tick;
+    m_nextId = 1;
+    for(GameObject* obj : m_gameObjects)
+    {
+        obj->m_lodTick = m_tick;
+        m_nextId = std::max(m_nextId, obj->m_id + 1);
+    }
+}
+
+void Simulation::setSaveCapture(SaveGame *save)
+{
+    m_saveCapture = save;
+    if(save != nullptr)
+        return;
+
+    for(GameObject* obj : m_graveyard)
+        delete obj;
+    m_graveyard.clear();
+}
+
+void Simulation::preserve(GameObject *obj)
+{
+    if(m_saveCapture != nullptr)
+        m_saveCapture->preserve(obj);
+}
+
+void Simulation::populate()
+{
+    for(int i = 0; i < 5; i++)
+    {
+        for(int j = 0; j < 7; j++)
+        {
+            Cube* cube = new Cube();
+
+            cube->position.setX(j * 1 - 3);
+            cube->position.setY(0);
+            cube->position.setZ(i * 1 - 6);
+
+            cube->material_color.setX(i * 0.2f);
+            cube->material_color.setY(0.5f);
+            cube->material_color.setZ(j * 0.1f);
+
+            cube->scale = QVector3D(0.3f,0.3f,0.3f);
+
+            cube->m_radius = 0.5f * sqrt(3 * cube->scale.x() * cube->scale.x());
+            cube->m_material = TextureManager::getMaterial((i + j) % 2 ? "brick1" : "brick");
+
+            addObject(cube);
+        }
+    }
+}
+
+void Simulation::populateGrid(int count)
+{
+    int side = int(ceil(sqrt(double(count))));
+    for(int i = 0; i < count; i++)
+    {
+        GameObject* cube = createObject(GameObject::CubeType);
+        cube->position = QVector3D((i % side) * 0.9f, 0.0f, (i / side) * 1.5f);
+        cube->m_radius = 0.5f;
+        addObject(cube);
+    }
+}
+
+Bullet* Simulation::spawnBullet(const Player &player)
+{
+    Bullet* bullet=new Bullet();
+    bullet->position=player.position+player.direction*0.7f;
+    bullet->position.setY(0);
+    bullet->scale=QVector3D(0.5f,0.5f,0.5f);
+    bullet->m_radius=0.5f;
+    bullet->energy=3*player.direction;
+    bullet->energy.setY(0);
+    addObject(bullet);
+    return bullet;
+}
+
+constexpr float Simulation::LodNearDistance;
+constexpr float Simulation::LodFarDistance;
+constexpr float Simulation::MinCellSize;
+constexpr float Simulation::RestEnergy;
+
+bool Simulation::isAtRest() const
+{
+    for(const GameObject* obj : m_gameObjects)
+    {
+        if(obj->type() == GameObject::BulletType || obj->energy.lengthSquared() > RestEnergy * RestEnergy)
+            return false;
+    }
+    return true;
+}
+
+void Simulation::clearLodViews()
+{
+    m_lodViews.clear();
+}
+
+void Simulation::addLodView(const QVector3D &position, const QMatrix4x4 *viewProjection)
+{
+    LodView view;
+    view.position = position;
+    view.hasFrustum = viewProjection != nullptr;
+    if(view.hasFrustum)
+        view.frustum = Frustum(*viewProjection);
+    m_lodViews.push_back(view);
+}
+
+Simulation::LodTier Simulation::lodTier(const GameObject *obj) const
+{
+    if(m_lodViews.empty() || !obj->m_lodTiered)
+        return FullRate;
+
+    LodTier tier = Background;
+    for(const LodView& view : m_lodViews)
+    {
+        float d = (obj->position - view.position).length();
+        if(d < LodNearDistance)
+            return FullRate;
+
+        bool visible = view.hasFrustum && view.frustum.intersectsSphere(obj->position, obj->m_radius);
+        if(visible && d < LodFarDistance)
+            return FullRate;
+        if(visible || d < LodFarDistance)
+            tier = ReducedRate;
+    }
+    return tier;
+}
+
+void Simulation::scheduleLod()
+{
+    size_t count = m_gameObjects.size();
+    m_lodTicks = m_tickArena.allocate<int>(count);
+    std::fill(m_lodTicks, m_lodTicks + count, 1);
+    if(m_lodViews.empty())
+        return;
+
+    // an object off the full rate catches up on every tick since its last step,
+    // or since it was added or loaded
+    auto catchUp = [this](const GameObject* obj)
+    {
+        return qBound(1, int(m_tick + 1 - obj->m_lodTick), int(MaxLodTicks));
+    };
+
+    int* background = m_tickArena.allocate<int>(count);
+    size_t backgroundCount = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        GameObject* obj = m_gameObjects[i];
+        switch(lodTier(obj))
+        {
+        case FullRate:
+            break;
+        case ReducedRate:
+            // spread over buckets by id so every tick gets a similar share
+            m_lodTicks[i] = (m_tick + obj->m_id) % ReducedInterval == 0 ? catchUp(obj) : 0;
+            break;
+        case Background:
+            m_lodTicks[i] = 0;
+            background[backgroundCount++] = int(i);
+            break;
+        }
+    }
+
+    if(backgroundCount == 0)
+        return;
+    size_t budget = qMin(backgroundCount, size_t(BackgroundBudget));
+    for(size_t n = 0; n < budget; n++)
+    {
+        int i = background[(m_lodCursor + n) % backgroundCount];
+        m_lodTicks[i] = catchUp(m_gameObjects[i]);
+    }
+    m_lodCursor = (m_lodCursor + budget) % backgroundCount;
+}
+
+int Simulation::gridCell(float coordinate) const
+{
+    // bounded so far away or broken positions still give a valid cell
+    return int(floorf(qBound(-1e6f, coordinate / m_grid.cellSize, 1e6f)));
+}
+
+unsigned Simulation::gridBucket(int x, int y, int z) const
+{
+    return (unsigned(x) * 73856093u ^ unsigned(y) * 19349663u ^ unsigned(z) * 83492791u) & m_grid.mask;
+}
+
+void Simulation::linkInGrid(int i, unsigned bucket)
+{
+    m_grid.bucket[i] = bucket;
+    m_grid.prev[i] = -1;
+    m_grid.next[i] = m_grid.head[bucket];
+    if(m_grid.next[i] >= 0)
+        m_grid.prev[m_grid.next[i]] = i;
+    m_grid.head[bucket] = i;
+}
+
+void Simulation::unlinkFromGrid(int i)
+{
+    if(m_grid.prev[i] >= 0)
+        m_grid.next[m_grid.prev[i]] = m_grid.next[i];
+    else
+        m_grid.head[m_grid.bucket[i]] = m_grid.next[i];
+    if(m_grid.next[i] >= 0)
+        m_grid.prev[m_grid.next[i]] = m_grid.prev[i];
+}
+
+void Simulation::buildGrid()
+{
+    int count = int(m_gameObjects.size());
+    m_grid.maxRadius = 0.0f;
+    for(const GameObject* obj : m_gameObjects)
+        m_grid.maxRadius = qMax(m_grid.maxRadius, obj->m_radius);
+    m_grid.cellSize = qMax(2.0f * m_grid.maxRadius, MinCellSize);
+
+    // about two buckets per object keeps the lists short
+    unsigned buckets = MinGridBuckets;
+    while(buckets < unsigned(count) * 2)
+        buckets *= 2;
+    m_grid.mask = buckets - 1;
+
+    m_grid.head = m_tickArena.allocate<int>(buckets);
+    m_grid.next = m_tickArena.allocate<int>(size_t(count));
+    m_grid.prev = m_tickArena.allocate<int>(size_t(count));
+    m_grid.bucket = m_tickArena.allocate<unsigned>(size_t(count));
+    m_grid.seen = m_tickArena.allocate<int>(size_t(count));
+    std::fill(m_grid.head, m_grid.head + buckets, -1);
+    std::fill(m_grid.seen, m_grid.seen + count, -1);
+
+    // linked from the back so every bucket lists its objects in ascending order
+    for(int i = count - 1; i >= 0; i--)
+    {
+        const QVector3D& p = m_gameObjects[i]->position;
+        linkInGrid(i, gridBucket(gridCell(p.x()), gridCell(p.y()), gridCell(p.z())));
+    }
+}
+
+void Simulation::moveInGrid(int i)
+{
+    const GameObject* obj = m_gameObjects[i];
+    m_grid.maxRadius = qMax(m_grid.maxRadius, obj->m_radius);
+    unsigned bucket = gridBucket(gridCell(obj->position.x()), gridCell(obj->position.y()), gridCell(obj->position.z()));
+    if(bucket == m_grid.bucket[i])
+        return;
+    unlinkFromGrid(i);
+    linkInGrid(i, bucket);
+}
+
+int Simulation::gatherCandidates(int i, int *candidates)
+{
+    const GameObject* obj = m_gameObjects[i];
+    float reach = obj->m_radius + m_grid.maxRadius;
+    const QVector3D& p = obj->position;
+    int x0 = gridCell(p.x() - reach), x1 = gridCell(p.x() + reach);
+    int y0 = gridCell(p.y() - reach), y1 = gridCell(p.y() + reach);
+    int z0 = gridCell(p.z() - reach), z1 = gridCell(p.z() + reach);
+
+    int count = 0;
+    double cells = double(x1 - x0 + 1) * double(y1 - y0 + 1) * double(z1 - z0 + 1);
+    if(cells > double(m_grid.mask) + 1.0)
+    {
+        // reaches over more cells than there are buckets, every object is a candidate
+        for(int j = 0; j < int(m_gameObjects.size()); j++)
+        {
+            if(j != i)
+                candidates[count++] = j;
+        }
+        return count;
+    }
+
+    // different cells can share a bucket, seen keeps an object from being listed twice
+    for(int x = x0; x <= x1; x++)
+    {
+        for(int y = y0; y <= y1; y++)
+        {
+            for(int z = z0; z <= z1; z++)
+            {
+                for(int j = m_grid.head[gridBucket(x, y, z)]; j >= 0; j = m_grid.next[j])
+                {
+                    if(j == i || m_grid.seen[j] == i)
+                        continue;
+                    m_grid.seen[j] = i;
+                    candidates[count++] = j;
+                }
+            }
+        }
+    }
+    // the pair responses depend on the order, it has to match a scan over all objects
+    std::sort(candidates, candidates + count);
+    return count;
+}
+
+void Simulation::step()
+{
+    scheduleLod();
+    buildGrid();
+    int* candidates = m_tickArena.allocate<int>(m_gameObjects.size());
+
+    // only stepped objects run the pair test, against the objects the grid finds near
+    // them; skipped objects still collide as the other side of a pair
+    for(int i = 0; i < m_gameObjects.size(); i++)
+    {
+        if(m_lodTicks[i] == 0)
+            continue;
+
+        GameObject* obj = m_gameObjects[i];
+        preserve(obj);
+        int candidateCount = gatherCandidates(i, candidates);
+        for(int c = 0; c < candidateCount; c++)
+        {
+            GameObject* obj2 = m_gameObjects[candidates[c]];
+
+            // layer filter before the distance test
+            if(!(obj->m_collisionMask & Collision::layerBit(obj2->m_layer)))
+                continue;
+
+            QVector3D v = obj->position - obj2->position;
+            float d = v.length();
+
+            if(d < (obj->m_radius + obj2->m_radius))
+            {
+                switch(Collision::response(obj->m_layer, obj2->m_layer))
+                {
+                case Collision::Bounce:
+                {
+                    preserve(obj2);
+                    v.normalize();
+                    float energySum=obj->energy.length()+obj2->energy.length();
+                    obj->energy=v*energySum/2;
+                    obj2->energy=-v*energySum/2;
+                    if(m_particles!=nullptr && energySum>0.01f)
+                        m_particles->emit(ParticleSystem::Collision, (obj->position+obj2->position)*0.5f, QVector3D(0,0,0), qMin(64, int(energySum*200)));
+                    break;
+                }
+                case Collision::Ignore:
+                    break;
+                }
+            }
+        }
+        if(m_lodTicks[i] == 1)
+            obj->update();
+        else
+            obj->advance(m_lodTicks[i]);
+        obj->m_lodTick = m_tick + 1;
+        moveInGrid(i);
+    }
+    for(int i=0; i<m_gameObjects.size();)
+    {
+        GameObject* obj=m_gameObjects[i];
+        if(obj->isAlive==false)
+        {
+            if(m_particles!=nullptr && obj->type()==GameObject::BulletType)
+                m_particles->emit(ParticleSystem::Impact, obj->position, obj->energy, 256);
+            m_gameObjects.erase(m_gameObjects.begin()+i);
+            if(m_saveCapture != nullptr)
+                m_graveyard.push_back(obj);
+            else
+                delete obj;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    m_tickArena.reset();
+    m_lodTicks = nullptr;
+    m_tick++;
+}
@@ -0,0 +1,126 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <vector>
+#include <QMatrix4x4>
+#include "gameobject.h"
+#include "arena.h"
+#include "frustum.h"
+
+class Player;
+class Bullet;
+class ParticleSystem;
+class SaveGame;
+
+// the tick logic shared by the widget and the headless server
+class Simulation
+{
+public:
+    Simulation();
+
+    void addObject(GameObject* obj);
+    void removeObject(GameObject* obj);
+    GameObject* createObject(GameObject::Type type);
+    GameObject* cloneObject(const GameObject* prototype);
+
+    // deletes every object except keep
+    void clear(const GameObject* keep = nullptr);
+    // takes over objects loaded by SaveGame::load; they are still separate heap
+    // allocations cloned from a prototype, one new per object, because objects are
+    // polymorphic and deleted one by one, so a save cannot be mapped into their storage
+    void restore(std::vector<GameObject*>&& objects, quint32 tick);
+
+    // while a save captures the world, objects are handed to it before step() changes
+    // them and dead objects are parked instead of deleted; null ends the capture
+    void setSaveCapture(SaveGame* save);
+
+    // simulation LOD: with no views every object is stepped every tick, otherwise objects
+    // near a view or inside its frustum run at full rate, the rest less often with
+    // accumulated ticks, the farthest in round robin under a fixed per-tick budget;
+    // only types with GameObject::m_lodTiered are tiered, the rest always run at full rate
+    enum LodTier
+    {
+        FullRate,
+        ReducedRate,
+        Background
+    };
+
+    static constexpr float LodNearDistance = 15.0f;
+    static constexpr float LodFarDistance = 50.0f;
+    static const int ReducedInterval = 4;
+    static const int BackgroundBudget = 128;
+    static const int MaxLodTicks = 64;
+
+    void clearLodViews();
+    void addLodView(const QVector3D& position, const QMatrix4x4* viewProjection = nullptr);
+    LodTier lodTier(const GameObject* obj) const;
+
+    // no bullet in flight and nothing left moving, stepping would change nothing
+    static constexpr float RestEnergy = 1e-4f;
+    bool isAtRest() const;
+
+    void populate();
+    // count touching cubes on a square grid, at rest, for the headless checks and benchmarks
+    void populateGrid(int count);
+    void step();
+    Bullet* spawnBullet(const Player& player);
+
+    std::vector<GameObject*> m_gameObjects;
+
+    // optional sink for collision and impact effects, null on the server
+    ParticleSystem* m_particles;
+
+    quint32 m_tick;
+
+private:
+    struct LodView
+    {
+        QVector3D position;
+        Frustum frustum;
+        bool hasFrustum;
+    };
+
+    // broad phase: every object hashed into a uniform grid at the start of the tick and
+    // relinked when it moves, a stepped object only tests the objects in the cells its
+    // radius plus the largest radius can reach
+    struct Grid
+    {
+        float cellSize;
+        float maxRadius;
+        unsigned mask;
+        int* head;          // first object of each bucket, -1 when empty
+        int* next;
+        int* prev;
+        unsigned* bucket;   // the bucket each object is linked into
+        int* seen;          // the last object whose candidates included it
+    };
+
+    static const int MinGridBuckets = 64;
+    static constexpr float MinCellSize = 1.0f;
+
+    void scheduleLod();
+    void buildGrid();
+    int gridCell(float coordinate) const;
+    unsigned gridBucket(int x, int y, int z) const;
+    void linkInGrid(int i, unsigned bucket);
+    void unlinkFromGrid(int i);
+    void moveInGrid(int i);
+    // the objects that can overlap object i, in ascending order
+    int gatherCandidates(int i, int* candidates);
+
+    std::vector<LodView> m_lodViews;
+    // transient per tick data, released at the end of step()
+    Arena m_tickArena;
+    int* m_lodTicks;     // ticks each object advances this step, 0 skips it
+    size_t m_lodCursor;
+    Grid m_grid;
+
+    void preserve(GameObject* obj);
+
+    SaveGame* m_saveCapture;
+    std::vector<GameObject*> m_graveyard;
+
+    quint32 m_nextId;
+};
+
+#endif // SIMULATION_H
@@ -1,6 +1,17 @@
 #include "texturemanager.h"
+#include <QOpenGLContext>
+#include <QImage>
+#include <QPainter>
+#include <iostream>
+
+using namespace std;
+
+std::vector<TextureManager::Material> TextureManager::m_materials = {
+    { "brick", "resources/brick.jpg", nullptr, 0.0f, QVector4D(0, 0, 1, 1) },
+    { "brick1", "resources/brick1.jpg", nullptr, 0.0f, QVector4D(0, 0, 1, 1) }
+};
+QOpenGLTexture* TextureManager::m_array = nullptr;
 
-std::map<std::string, QOpenGLTexture*> TextureManager::m_textures;
 TextureManager::TextureManager()
 {
 
@@ -8,10 +19,136 @@ TextureManager::TextureManager()
 
 void TextureManager::init()
 {
-    m_textures["brick"]=new QOpenGLTexture(QImage("resources/brick.jpg"));
+    std::vector<QImage> images;
+    for(const Material& material : m_materials)
+    {
+        QImage image(QString::fromStdString(material.file));
+        cout << "Loading " << material.file << " - " << (image.isNull() ? "Not Found!" : "Found!") << endl;
+        if(image.isNull())
+        {
+            image = QImage(1, 1, QImage::Format_RGBA8888);
+            image.fill(Qt::white);
+        }
+        images.push_back(image.convertToFormat(QImage::Format_RGBA8888));
+    }
+
+    // the shaders are GLSL 1.10, array samplers come from GL_EXT_texture_array
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context->isOpenGLES() || !context->hasExtension("GL_EXT_texture_array"))
+    {
+        for(size_t i = 0; i < m_materials.size(); i++)
+            m_materials[i].texture = new QOpenGLTexture(images[i]);
+        return;
+    }
+
+    std::vector<QImage> layers;
+    int atlas = -1;
+    int x = 0, y = 0, shelf = 0;
+    for(size_t i = 0; i < m_materials.size(); i++)
+    {
+        const QImage& image = images[i];
+        Material& material = m_materials[i];
+
+        if(image.width() > AtlasMaxSize || image.height() > AtlasMaxSize)
+        {
+            layers.push_back(image.scaled(LayerSize, LayerSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+            material.layer = float(layers.size() - 1);
+            material.rect = QVector4D(0, 0, 1, 1);
+            continue;
+        }
+
+        // shelf packing, a new atlas layer when the current one is full; cells are aligned
+        // to the texel size of the last mip level so no texel there straddles two entries
+        const int align = 1 << (AtlasMipLevels - 1);
+        int w = (image.width() + 2 * AtlasPadding + align - 1) & ~(align - 1);
+        int h = (image.height() + 2 * AtlasPadding + align - 1) & ~(align - 1);
+        if(atlas >= 0 && x + w > LayerSize)
+        {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+        if(atlas < 0 || y + h > LayerSize)
+        {
+            layers.push_back(QImage(LayerSize, LayerSize, QImage::Format_RGBA8888));
+            layers.back().fill(Qt::black);
+            atlas = int(layers.size() - 1);
+            x = y = shelf = 0;
+        }
+
+        // the stretched copy under the image fills the padding with its edge colors
+        QPainter painter(&layers[atlas]);
+        painter.drawImage(QRect(x, y, w, h), image);
+        painter.drawImage(QPoint(x + AtlasPadding, y + AtlasPadding), image);
+        painter.end();
+
+        // layers are flipped on upload like QOpenGLTexture does, v runs bottom up
+        material.layer = float(atlas);
+        material.rect = QVector4D(float(x + AtlasPadding) / LayerSize,
+                                  float(LayerSize - y - AtlasPadding - image.height()) / LayerSize,
+                                  float(image.width()) / LayerSize,
+                                  float(image.height()) / LayerSize);
+        x += w;
+        shelf = qMax(shelf, h);
+    }
+
+    m_array = new QOpenGLTexture(QOpenGLTexture::Target2DArray);
+    m_array->setSize(LayerSize, LayerSize);
+    m_array->setLayers(int(layers.size()));
+    m_array->setFormat(QOpenGLTexture::RGBA8_UNorm);
+    // further down the atlas entries would bleed into each other
+    int mipLevels = atlas >= 0 ? AtlasMipLevels : m_array->maximumMipLevels();
+    m_array->setMipLevels(mipLevels);
+    m_array->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+    for(size_t l = 0; l < layers.size(); l++)
+    {
+        QImage flipped = layers[l].mirrored();
+        m_array->setData(0, int(l), QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, flipped.constBits());
+    }
+    m_array->generateMipMaps();
+    m_array->setMipMaxLevel(mipLevels - 1);
+    m_array->setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+    m_array->setWrapMode(QOpenGLTexture::Repeat);
+
+    cout << "Textures: " << m_materials.size() << " materials in " << layers.size() << " array layers" << endl;
+}
+
+void TextureManager::cleanup()
+{
+    delete m_array;
+    m_array = nullptr;
+    for(Material& material : m_materials)
+    {
+        delete material.texture;
+        material.texture = nullptr;
+    }
+}
+
+qint16 TextureManager::getMaterial(const std::string &name)
+{
+    for(size_t i = 0; i < m_materials.size(); i++)
+    {
+        if(m_materials[i].name == name)
+            return qint16(i);
+    }
+    return NoMaterial;
+}
+
+const TextureManager::Material& TextureManager::material(qint16 index)
+{
+    return m_materials[index];
+}
+
+QOpenGLTexture* TextureManager::texture(qint16 index)
+{
+    if(index == NoMaterial)
+        return nullptr;
+    return m_array != nullptr ? m_array : m_materials[index].texture;
 }
 
-QOpenGLTexture* TextureManager::getTexture(std::string name)
+QByteArray TextureManager::shaderDefines()
 {
-    return m_textures[name];
+    if(m_array == nullptr)
+        return QByteArray();
+    return "#extension GL_EXT_texture_array : enable\n#define TEXTURE_ARRAY\n";
 }
@@ -1,17 +1,48 @@
 #ifndef TEXTUREMANAGER_H
 #define TEXTUREMANAGER_H
 
-#include <map>
 #include <string>
+#include <vector>
+#include <QByteArray>
+#include <QVector4D>
 #include <QOpenGLTexture>
 
+// objects refer to materials by index; where array textures are supported every material
+// lives in one GL_TEXTURE_2D_ARRAY, large images as whole layers and small ones packed
+// into atlas layers, so objects with different materials can share one draw
 class TextureManager
 {
 public:
+    static const qint16 NoMaterial = -1;
+    static const int LayerSize = 1024;
+    static const int AtlasMaxSize = 512;    // images up to this size go into an atlas layer
+    static const int AtlasPadding = 4;
+    // mip levels that still keep a texel of padding around every atlas entry
+    static const int AtlasMipLevels = 3;
+
+    struct Material
+    {
+        std::string name;
+        std::string file;
+        QOpenGLTexture* texture;    // own 2D texture when there is no texture array
+        float layer;
+        QVector4D rect;             // uv offset in xy, uv size in zw
+    };
+
     TextureManager();
     static void init();
-    static std::map<std::string, QOpenGLTexture*> m_textures;
-    static QOpenGLTexture* getTexture(std::string name);
+    // frees the array and the per material textures while the context is current,
+    // material indices stay valid so init() can load them again
+    static void cleanup();
+    static qint16 getMaterial(const std::string& name);
+    static const Material& material(qint16 index);
+    // what has to be bound to draw the material, null for NoMaterial
+    static QOpenGLTexture* texture(qint16 index);
+    static bool hasTextureArray() { return m_array != nullptr; }
+    static QByteArray shaderDefines();
+
+    static std::vector<Material> m_materials;
+    static QOpenGLTexture* m_array;
 };
 
 #endif // TEXTUREMANAGER_H
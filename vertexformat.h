@@ -0,0 +1,156 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <qopengl.h>
+#include <QVector2D>
+#include <QVector3D>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+#ifndef GL_INT_2_10_10_10_REV
+#define GL_INT_2_10_10_10_REV 0x8D9F
+#endif
+
+struct VertexAttribute
+{
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+// positions of quantized formats are stored in [-1,1] and mapped back
+// to model space by: position = offset + scale * stored
+struct Dequantization
+{
+    QVector3D offset = QVector3D(0.0f, 0.0f, 0.0f);
+    float scale = 1.0f;
+};
+
+namespace VertexPacking
+{
+    inline float clampUnit(float v, float lo)
+    {
+        return v < lo ? lo : (v > 1.0f ? 1.0f : v);
+    }
+
+    inline int32_t snorm10x3(const QVector3D& n)
+    {
+        int32_t x = int32_t(std::lround(clampUnit(n.x(), -1.0f) * 511.0f)) & 0x3FF;
+        int32_t y = int32_t(std::lround(clampUnit(n.y(), -1.0f) * 511.0f)) & 0x3FF;
+        int32_t z = int32_t(std::lround(clampUnit(n.z(), -1.0f) * 511.0f)) & 0x3FF;
+        return x | (y << 10) | (z << 20);
+    }
+
+    inline int16_t snorm16(float v)
+    {
+        return int16_t(std::lround(clampUnit(v, -1.0f) * 32767.0f));
+    }
+
+    // clamps to [0,1], uvs that tile past it need a half float format
+    inline uint16_t unorm16(float v)
+    {
+        return uint16_t(std::lround(clampUnit(v, 0.0f) * 65535.0f));
+    }
+
+    inline uint16_t half(float v)
+    {
+        uint32_t f;
+        std::memcpy(&f, &v, sizeof(f));
+        uint32_t sign = (f >> 16) & 0x8000;
+        int32_t exponent = int32_t((f >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = f & 0x7FFFFF;
+
+        if(exponent <= 0)
+            return uint16_t(sign);
+        if(exponent >= 31)
+            return uint16_t(sign | 0x7C00);
+        return uint16_t(sign | ((uint32_t(exponent) << 10) + ((mantissa + 0x1000) >> 13)));
+    }
+}
+
+// 32 bytes, the original layout: float position, float normal, float uv
+struct VertexP3fN3fT2f
+{
+    GLfloat position[3];
+    GLfloat normal[3];
+    GLfloat uv[2];
+
+    static const bool quantized = false;
+
+    static constexpr std::array<VertexAttribute, 3> attributes()
+    {
+        return {{
+            { 0, 3, GL_FLOAT, GL_FALSE, offsetof(VertexP3fN3fT2f, position) },
+            { 1, 3, GL_FLOAT, GL_FALSE, offsetof(VertexP3fN3fT2f, normal) },
+            { 2, 2, GL_FLOAT, GL_FALSE, offsetof(VertexP3fN3fT2f, uv) }
+        }};
+    }
+
+    static VertexP3fN3fT2f pack(const QVector3D& v, const QVector3D& n, const QVector2D& uv, const Dequantization&)
+    {
+        return {{ v.x(), v.y(), v.z() }, { n.x(), n.y(), n.z() }, { uv.x(), uv.y() }};
+    }
+};
+
+// 20 bytes: float position, 10_10_10_2 normal, half float uv, picked for
+// meshes whose uvs leave [0,1] to repeat the texture
+struct VertexP3fN10T2h
+{
+    GLfloat position[3];
+    int32_t normal;
+    uint16_t uv[2];
+
+    static const bool quantized = false;
+
+    static constexpr std::array<VertexAttribute, 3> attributes()
+    {
+        return {{
+            { 0, 3, GL_FLOAT, GL_FALSE, offsetof(VertexP3fN10T2h, position) },
+            { 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(VertexP3fN10T2h, normal) },
+            { 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(VertexP3fN10T2h, uv) }
+        }};
+    }
+
+    static VertexP3fN10T2h pack(const QVector3D& v, const QVector3D& n, const QVector2D& uv, const Dequantization&)
+    {
+        using namespace VertexPacking;
+        return {{ v.x(), v.y(), v.z() }, snorm10x3(n), { half(uv.x()), half(uv.y()) }};
+    }
+};
+
+// 16 bytes: snorm16 position quantized to the mesh bounds, 10_10_10_2 normal, unorm16 uv,
+// the uv is clamped to [0,1] so it only fits meshes that do not tile their texture
+struct VertexP3sN10T2us
+{
+    int16_t position[4];
+    int32_t normal;
+    uint16_t uv[2];
+
+    static const bool quantized = true;
+
+    static constexpr std::array<VertexAttribute, 3> attributes()
+    {
+        return {{
+            { 0, 3, GL_SHORT, GL_TRUE, offsetof(VertexP3sN10T2us, position) },
+            { 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(VertexP3sN10T2us, normal) },
+            { 2, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(VertexP3sN10T2us, uv) }
+        }};
+    }
+
+    static VertexP3sN10T2us pack(const QVector3D& v, const QVector3D& n, const QVector2D& uv, const Dequantization& dq)
+    {
+        using namespace VertexPacking;
+        QVector3D q = (v - dq.offset) / dq.scale;
+        return {{ snorm16(q.x()), snorm16(q.y()), snorm16(q.z()), 0 }, snorm10x3(n), { unorm16(uv.x()), unorm16(uv.y()) }};
+    }
+};
+
+#endif // VERTEXFORMAT_H